@@ -60,7 +60,10 @@
 #define ALIGNMENT 8  
 
 /* 
- * Maximum heap size in bytes 
+ * Maximum heap size in bytes.  This is the default; mem_set_max_heap
+ * changes it at run time.  The allocator tables with an entry for every
+ * few bytes of heap (fit tree, free map, dense index, slab pages) only
+ * cover this many bytes.
  */
 #define MAX_HEAP (20*(1<<20))  /* 20 MB */
 
@@ -15,11 +15,13 @@
 #include <time.h>
 
 
-//one of these two should be defined
+//one of these three should be defined
 #ifdef IMPLICIT
 #include "mmImplicit.h"
 #elif EXPLICIT
 #include "mmExplicit.h"
+#elif TLSF
+#include "mmTLSF.h"
 #endif
 
 #include "memlib.h"
@@ -35,8 +37,14 @@
 #define HDRLINES       4 /* number of header lines in a trace file */
 #define LINENUM(i) (i+5) /* cnvt trace request nums to linenums (origin 1) */
 
+/* The realloc growth benchmark (-R) */
+#define RB_BLOCKS      4        /* blocks grown in turn */
+#define RB_MAX   (2 << 20)      /* size the blocks are grown to */
+#define RB_THRESHOLD (128 << 10)/* mapping threshold when -M isn't given */
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
 /* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p)  ((((unsigned int)(p)) % ALIGNMENT) == 0)
+#define IS_ALIGNED(p)  ((((unsigned long)(p)) % ALIGNMENT) == 0)
 
 /****************************** 
  * The key compound data types 
@@ -91,6 +99,8 @@ typedef struct
 
     /* defined only for the student malloc package */
     double util;     /* space utilization for this trace (always 0 for libc) */
+    double p99;      /* 99th percentile time of one op in usecs (0 for libc) */
+    int sbrks;       /* mem_sbrk calls made while measuring util (0 for libc) */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t; 
@@ -100,6 +110,8 @@ typedef struct
  *******************/
 int verbose = 0;        /* global flag for verbose output */
 static int errors = 0;  /* number of errs found when running student malloc */
+static int reallocBench = 0; /* run the realloc growth benchmark (set by -R) */
+static int comparePages = 0; /* run again with huge pages (set by -H) */
 char msg[MAXLINE];      /* for whenever we need to compose an error message */
 
 /* Directory where default tracefiles are found */
@@ -134,9 +146,13 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static double eval_mm_latency(trace_t *trace);
+static int cmp_double(const void *a, const void *b);
+static void eval_realloc_growth(int threshold);
 
 /* Various helper routines */
 static void printresults(int n, stats_t *stats);
+static void printpages(int n, stats_t *small, stats_t *huge);
 static void usage(void);
 static void unix_error(char *msg);
 static void malloc_error(int tracenum, int opnum, char *msg);
@@ -161,6 +177,7 @@ int main(int argc, char **argv)
     int num_tracefiles = 0;    /* the number of traces in that array */
     stats_t *libc_stats = NULL;/* libc stats for each trace */
     stats_t *mm_stats = NULL;  /* mm (i.e. student) stats for each trace */
+    stats_t *huge_stats = NULL;/* mm stats with the heap in huge pages */
     int run_libc = 0;    /* If set, run libc malloc (set by -l) */
 
     /* variables used compute the performance index */
@@ -171,6 +188,8 @@ int main(int argc, char **argv)
     printf("Running the implicit free list allocator\n");
 #elif EXPLICIT
     printf("Running the explicit free list allocator\n");
+#elif TLSF
+    printf("Running the two-level segregated fit allocator\n");
 #endif
     
     /* 
@@ -209,6 +228,39 @@ int main(int argc, char **argv)
     printf("Number correct = %d out of %d\n", numcorrect, num_tracefiles);
     printf("\n");
 
+    /*
+     * Optionally run the traces again with the heap in huge pages
+     */
+    if (comparePages)
+    {
+        if (mem_set_hugepages(1) < 0)
+            printf("Huge pages aren't available on this system.\n\n");
+        else
+        {
+            if (verbose) printf("Testing mm malloc with huge pages\n");
+            mem_deinit();
+            runStudentMalloc(num_tracefiles, tracefiles, &huge_stats);
+            printf("Results for mm malloc with huge pages:\n");
+            printresults(num_tracefiles, huge_stats);
+            printf("\n");
+            printpages(num_tracefiles, mm_stats, huge_stats);
+            printf("\n");
+        }
+    }
+
+    /*
+     * Optionally grow a few large blocks with realloc, first in the
+     * heap and then with mappings of their own
+     */
+    if (reallocBench)
+    {
+        printf("Realloc growth:\n");
+        printf("%-8s%10s%10s%12s\n", "", "reallocs", "MB copied", "us/realloc");
+        eval_realloc_growth(0);
+        eval_realloc_growth(mmapThreshold > 0 ? mmapThreshold : RB_THRESHOLD);
+        printf("\n");
+    }
+
     exit(0);
 }
 
@@ -278,7 +330,7 @@ void parseArgs(int argc, char ** argv, int * num_tracefiles, int * run_libc,
                char ***tracefiles)
 {
     char c;
-    while ((c = getopt(argc, argv, "f:t:hvVglw:")) != EOF)
+    while ((c = getopt(argc, argv, "f:t:hHvVgbdilqRso:w:n:x:c:m:r:M:")) != EOF)
     {
         switch (c)
         {
@@ -299,6 +351,45 @@ void parseArgs(int argc, char ** argv, int * num_tracefiles, int * run_libc,
             case 'l': /* Run libc malloc */
                 (*run_libc) = 1;
                 break;
+            case 'm': /* Heap limit in MB */
+                /* block sizes and free list links are 32 bits */
+                if (atoi(optarg) < 1 || atoi(optarg) >= 4096)
+                {
+                    usage();
+                    exit(1);
+                }
+                mem_set_max_heap((size_t)atoi(optarg) << 20);
+                break;
+            case 'H': /* Run the traces again with huge pages */
+                comparePages = 1;
+                break;
+            case 'R': /* Run the realloc growth benchmark */
+                reallocBench = 1;
+                break;
+            case 'r': /* Give free blocks of at least this many KB back */
+                trimThreshold = atoi(optarg) * 1024;
+                if (trimThreshold < 0)
+                {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'M': /* Map requests of at least this many KB */
+                mmapThreshold = atoi(optarg) * 1024;
+                if (mmapThreshold < 0)
+                {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'c': /* Grow the heap by a percent of its size */
+                growthPercent = atoi(optarg);
+                if (growthPercent < 0)
+                {
+                    usage();
+                    exit(1);
+                }
+                break;
             case 'w':
                 if (strcmp(optarg, "first") == 0)
                     whichfit = FIRSTFIT;
@@ -306,12 +397,68 @@ void parseArgs(int argc, char ** argv, int * num_tracefiles, int * run_libc,
                     whichfit = NEXTFIT;
                 else if (strcmp(optarg, "best") == 0)
                     whichfit = BESTFIT;
+#ifndef TLSF
+                else if (strcmp(optarg, "good") == 0)
+                    whichfit = GOODFIT;
+#endif
+#ifdef EXPLICIT
+                else if (strcmp(optarg, "seg") == 0)
+                    whichfit = SEGFIT;
+#endif
+                else
+                {
+                    usage();
+                    exit(1);
+                }
+                break;
+#ifndef TLSF
+            case 'n': /* Number of blocks good fit looks at */
+                goodProbes = atoi(optarg);
+                if (goodProbes < 1)
+                {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'x': /* How much too big a block good fit takes right away */
+                goodSlack = atoi(optarg);
+                if (goodSlack < 0)
+                {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'q': /* Keep small freed blocks in fast bins */
+                useFastBins = 1;
+                break;
+#endif
+#ifdef IMPLICIT
+            case 'b': /* Skip allocated blocks with the free map */
+                useBitmap = 1;
+                break;
+            case 'i': /* Find first fit blocks with the fit tree */
+                useFitTree = 1;
+                break;
+#endif
+#ifdef EXPLICIT
+            case 'd': /* Search a dense index of the free blocks */
+                useIndex = 1;
+                break;
+            case 's': /* Serve tiny requests from slabs */
+                useSlabs = 1;
+                break;
+            case 'o': /* How freed blocks are put in the free lists */
+                if (strcmp(optarg, "lifo") == 0)
+                    whichorder = LIFO;
+                else if (strcmp(optarg, "addr") == 0)
+                    whichorder = ADDRORDER;
                 else
                 {
                     usage();
                     exit(1);
                 }
                 break;
+#endif
             case 'v': /* Print per-trace performance breakdown */
                 verbose = 1;
                 break;
@@ -323,6 +470,17 @@ void parseArgs(int argc, char ** argv, int * num_tracefiles, int * run_libc,
                 exit(1);
         }
     }
+    /* a build with the policies fixed at compile time ignores -w, -o
+       and -q, so report what it was built with */
+#ifdef FIT
+    whichfit = FIT;
+#endif
+#ifdef ORDER
+    whichorder = ORDER;
+#endif
+#ifdef FAST
+    useFastBins = FAST;
+#endif
     //tell user what trace files are going to be used
     if ((*tracefiles) == NULL)
     {
@@ -331,12 +489,49 @@ void parseArgs(int argc, char ** argv, int * num_tracefiles, int * run_libc,
         printf("Using default tracefiles in %s.\n", tracedir);
     }
     //tell user which placement policy is going to be used
+#ifdef TLSF
+    printf("Using the TLSF good fit placement policy (-w is ignored).\n");
+#else
     if (whichfit == FIRSTFIT)
        printf("Using the first fit placement policy.\n");
     else if (whichfit == NEXTFIT)
        printf("Using the next fit placement policy.\n");
     else if (whichfit == BESTFIT)
        printf("Using the best fit placement policy.\n");
+    else if (whichfit == GOODFIT)
+       printf("Using the good fit placement policy (%d probes, %d%% slack).\n",
+              goodProbes, goodSlack);
+#ifdef EXPLICIT
+    else if (whichfit == SEGFIT)
+       printf("Using the segregated fit placement policy.\n");
+#endif
+    if (useFastBins)
+       printf("Using fast bins for small blocks.\n");
+#endif
+    if (growthPercent > 0)
+       printf("Growing the heap by %d%% of its size.\n", growthPercent);
+    if (trimThreshold > 0)
+       printf("Giving free blocks of %d KB or more back to the OS.\n",
+              trimThreshold / 1024);
+    if (mmapThreshold > 0)
+       printf("Mapping requests of %d KB or more on their own.\n",
+              mmapThreshold / 1024);
+    if (mem_max_heapsize() != MAX_HEAP)
+       printf("Limiting the heap to %zu MB.\n", mem_max_heapsize() >> 20);
+#ifdef IMPLICIT
+    if (useFitTree)
+       printf("Using a max tree over the heap for first fit.\n");
+    if (useBitmap)
+       printf("Using a bitmap of the free blocks in the searches.\n");
+#endif
+#ifdef EXPLICIT
+    if (useSlabs)
+       printf("Using slabs for requests of up to 64 bytes.\n");
+    if (whichorder == ADDRORDER)
+       printf("Keeping the free lists in address order.\n");
+    if (useIndex)
+       printf("Searching a dense index of the free blocks.\n");
+#endif
 
 }
 
@@ -415,10 +610,12 @@ void runStudentMalloc(int num_tracefiles, char ** tracefiles, stats_t ** mm_stat
         {
             if (verbose) printf("Checking mm_alloc for efficiency.\n");
             (*mm_stats)[i].util = eval_mm_util(trace, i, &ranges);
+            (*mm_stats)[i].sbrks = mem_sbrk_calls();
             speed_params.trace = trace;
             speed_params.ranges = ranges;
             if (verbose) printf("Checking mm_alloc for performance.\n");
             (*mm_stats)[i].secs = fsecs(eval_mm_speed, &speed_params);
+            (*mm_stats)[i].p99 = eval_mm_latency(trace);
         }
         free_trace(trace);
     }
@@ -449,18 +646,21 @@ static int add_range(range_t **ranges, char *lo, int size,
     /* Payload addresses must be ALIGNMENT-byte aligned */
     if (!IS_ALIGNED(lo)) 
     {
-        sprintf(msg, "Payload address (%p) not aligned to %d bytes", 
-        lo, ALIGNMENT);
+        snprintf(msg, sizeof msg,
+                 "Payload address (%p) not aligned to %d bytes",
+                 lo, ALIGNMENT);
         malloc_error(tracenum, opnum, msg);
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
-        (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) 
+    /* The payload must lie within the extent of the heap, or in a
+       mapping of its own */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) || 
+         (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+        !mem_is_mapped(lo, size))
     {
-        sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)",
-                     lo, hi, mem_heap_lo(), mem_heap_hi());
+        snprintf(msg, sizeof msg, "Payload (%p:%p) lies outside heap (%p:%p)",
+                 lo, hi, mem_heap_lo(), mem_heap_hi());
         malloc_error(tracenum, opnum, msg);
         return 0;
     }
@@ -471,8 +671,9 @@ static int add_range(range_t **ranges, char *lo, int size,
         if ((lo >= p->lo && lo <= p-> hi) ||
             (hi >= p->lo && hi <= p->hi)) 
         {
-            sprintf(msg, "Payload (%p:%p) overlaps another payload (%p:%p)\n",
-                    lo, hi, p->lo, p->hi);
+            snprintf(msg, sizeof msg,
+                     "Payload (%p:%p) overlaps another payload (%p:%p)\n",
+                     lo, hi, p->lo, p->hi);
             malloc_error(tracenum, opnum, msg);
             return 0;
         }
@@ -556,7 +757,9 @@ static trace_t *read_trace(char *tracedir, char *filename)
     strcat(path, filename);
     if ((tracefile = fopen(path, "r")) == NULL) 
     {
-        sprintf(msg, "Could not open %s in read_trace", path);
+        /* leave room in msg for the rest of the message */
+        snprintf(msg, sizeof msg, "Could not open %.*s in read_trace",
+                 MAXLINE / 2, path);
         unix_error(msg);
     }
     fscanf(tracefile, "%d", &(trace->sugg_heapsize)); /* not used */
@@ -855,7 +1058,9 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges)
         }
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    /* the heap may have been trimmed, so use the largest it ever was,
+       counting blocks in their own mappings too */
+    return ((double)max_total_size / (double)mem_peak_footprint());
 }
 
 /*
@@ -908,6 +1113,137 @@ static void eval_mm_speed(void *ptr)
     }
 }
 
+/*
+ * eval_mm_latency - Runs the trace once more, timing every request on
+ *    its own, and returns the 99th percentile in microseconds.  Unlike
+ *    the throughput, this shows the occasional slow request, such as a
+ *    long search for a free block.
+ */
+static double eval_mm_latency(trace_t *trace)
+{
+    int i, index;
+    char *p;
+    double *lat, p99;
+    struct timespec start, end;
+
+    if ((lat = (double *)malloc(trace->num_ops * sizeof(double))) == NULL)
+        unix_error("malloc failed in eval_mm_latency");
+
+    mem_reset_brk();
+    if (mm_init() < 0)
+        app_error("mm_init failed in eval_mm_latency");
+
+    for (i = 0;  i < trace->num_ops;  i++)
+    {
+        index = trace->ops[i].index;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        switch (trace->ops[i].type)
+        {
+            case ALLOC: /* mm_malloc */
+                if ((p = mm_malloc(trace->ops[i].size)) == NULL)
+                    app_error("mm_malloc error in eval_mm_latency");
+                trace->blocks[index] = p;
+                break;
+
+            case REALLOC: /* mm_realloc */
+                p = mm_realloc(trace->blocks[index], trace->ops[i].size);
+                if (p == NULL)
+                    app_error("mm_realloc error in eval_mm_latency");
+                trace->blocks[index] = p;
+                break;
+
+            case FREE: /* mm_free */
+                mm_free(trace->blocks[index]);
+                break;
+
+            default:
+                app_error("Nonexistent request type in eval_mm_latency");
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        lat[i] = (end.tv_sec - start.tv_sec) * 1e6 +
+                 (end.tv_nsec - start.tv_nsec) / 1e3;
+    }
+
+    qsort(lat, trace->num_ops, sizeof(double), cmp_double);
+    p99 = lat[(int)(0.99 * (trace->num_ops - 1))];
+    free(lat);
+    return p99;
+}
+
+/*
+ * cmp_double - qsort comparison function for doubles
+ */
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * eval_realloc_growth - Grows RB_BLOCKS blocks in turn from 4 KB to
+ *    RB_MAX bytes, an eighth at a time, writing the new part of each
+ *    block as a program would.  Blocks of threshold bytes or more get
+ *    mappings of their own (0 keeps them all in the heap).  Prints the
+ *    number of reallocs, the bytes the allocator copied and the time
+ *    per realloc.
+ */
+static void eval_realloc_growth(int threshold)
+{
+    char *blocks[RB_BLOCKS];
+    size_t sizes[RB_BLOCKS], newsize;
+    size_t copied;
+    int i, n = 0, saved = mmapThreshold, grown;
+    double usecs = 0;
+    struct timespec start, end;
+
+    mmapThreshold = threshold;
+    mem_reset_brk();
+    if (mm_init() < 0)
+        app_error("mm_init failed in eval_realloc_growth");
+    copied = reallocCopied;
+
+    for (i = 0; i < RB_BLOCKS; i++)
+    {
+        sizes[i] = 4096;
+        if ((blocks[i] = mm_malloc(sizes[i])) == NULL)
+            app_error("mm_malloc error in eval_realloc_growth");
+        memset(blocks[i], i, sizes[i]);
+    }
+    do
+    {
+        grown = 0;
+        for (i = 0; i < RB_BLOCKS; i++)
+        {
+            if (sizes[i] >= RB_MAX)
+                continue;
+            newsize = MIN(sizes[i] + sizes[i] / 8, RB_MAX);
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            blocks[i] = mm_realloc(blocks[i], newsize);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            if (blocks[i] == NULL)
+                app_error("mm_realloc error in eval_realloc_growth");
+            usecs += (end.tv_sec - start.tv_sec) * 1e6 +
+                     (end.tv_nsec - start.tv_nsec) / 1e3;
+            memset(blocks[i] + sizes[i], i, newsize - sizes[i]);
+            sizes[i] = newsize;
+            n++;
+            grown = 1;
+        }
+    } while (grown);
+
+    for (i = 0; i < RB_BLOCKS; i++)
+        mm_free(blocks[i]);
+    copied = reallocCopied - copied;
+    mmapThreshold = saved;
+
+    if (threshold > 0)
+        printf("%-8s", "mapped");
+    else
+        printf("%-8s", "heap");
+    printf("%10d%10.1f%12.2f\n", n, copied / 1048576.0, usecs / n);
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -1011,36 +1347,50 @@ static void printresults(int n, stats_t *stats)
     double secs = 0;
     double ops = 0;
     double util = 0;
+    double p99 = 0;
+    int sbrks = 0;
 
     /* Print the individual results for each trace */
-    printf("%5s%7s %5s%8s%10s%6s\n", 
-       "trace", " valid", "util", "ops", "secs", "Kops");
+    printf("%5s%7s %5s%8s%10s%6s%9s%7s\n", 
+       "trace", " valid", "util", "ops", "secs", "Kops", "p99(us)", "sbrks");
     for (i=0; i < n; i++) 
     {
         if (stats[i].valid) 
         {
-            printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f\n", 
+            printf("%2d%10s%5.0f%%%8.0f%10.6f%6.0f", 
                    i, "yes", stats[i].util*100.0, stats[i].ops,
                    stats[i].secs, (stats[i].ops/1e3)/stats[i].secs);
+            /* there is no latency or sbrk count for libc */
+            if (stats[i].p99 > 0)
+                printf("%9.2f%7d\n", stats[i].p99, stats[i].sbrks);
+            else
+                printf("%9s%7s\n", "-", "-");
             secs += stats[i].secs;
             ops += stats[i].ops;
             util += stats[i].util;
+            p99 = (stats[i].p99 > p99) ? stats[i].p99 : p99;
+            sbrks += stats[i].sbrks;
         } else 
         {
-            printf("%2d%10s%6s%8s%10s%6s\n", 
-                   i, "no", "-", "-", "-", "-"); 
+            printf("%2d%10s%6s%8s%10s%6s%9s%7s\n", 
+                   i, "no", "-", "-", "-", "-", "-", "-"); 
         }
     }
 
-    /* Print the aggregate results for the set of traces */
+    /* Print the aggregate results for the set of traces; the p99
+       column shows the worst trace */
     if (errors == 0) 
     {
-        printf("%12s%5.0f%%%8.0f%10.6f%6.0f\n", 
+        printf("%12s%5.0f%%%8.0f%10.6f%6.0f", 
                "Total       ", (util/n)*100.0, ops, secs, (ops/1e3)/secs);
+        if (p99 > 0)
+            printf("%9.2f%7d\n", p99, sbrks);
+        else
+            printf("%9s%7s\n", "-", "-");
     } else 
     {
-        printf("%12s%6s%8s%10s%6s\n", 
-               "Total       ", "-", "-", "-", "-");
+        printf("%12s%6s%8s%10s%6s%9s%7s\n", 
+               "Total       ", "-", "-", "-", "-", "-", "-");
     }
 
 }
@@ -1072,22 +1422,97 @@ void malloc_error(int tracenum, int opnum, char *msg)
     printf("ERROR [trace %d, line %d]: %s\n", tracenum, LINENUM(opnum), msg);
 }
 
+/*
+ * printpages - Compare the throughput of each trace with the heap in
+ *    ordinary pages (small) and in huge pages (huge)
+ */
+static void printpages(int n, stats_t *small, stats_t *huge)
+{
+    int i;
+    double ops = 0, smallsecs = 0, hugesecs = 0;
+
+    printf("%5s%9s%9s%9s\n", "trace", "4K Kops", "2M Kops", "speedup");
+    for (i = 0; i < n; i++)
+    {
+        if (small[i].valid && huge[i].valid)
+        {
+            printf("%2d%12.0f%9.0f%8.2fx\n", i,
+                   (small[i].ops/1e3)/small[i].secs,
+                   (huge[i].ops/1e3)/huge[i].secs,
+                   small[i].secs/huge[i].secs);
+            ops += small[i].ops;
+            smallsecs += small[i].secs;
+            hugesecs += huge[i].secs;
+        } else
+        {
+            printf("%2d%12s%9s%9s\n", i, "-", "-", "-");
+        }
+    }
+    if (errors == 0)
+        printf("%5s%9.0f%9.0f%8.2fx\n", "Total", (ops/1e3)/smallsecs,
+               (ops/1e3)/hugesecs, smallsecs/hugesecs);
+}
+
 /* 
  * usage - Explain the command line arguments
  */
 static void usage(void) 
 {
 #ifdef IMPLICIT
-    fprintf(stderr, "Usage: implicit [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: implicit [-hHvVabilqR] [-c <pct>] [-f <file>] [-m <MB>] [-M <KB>]\n\t\t[-n <probes>] [-r <KB>] [-t <dir>] [-x <pct>]\n");
 #elif EXPLICIT
-    fprintf(stderr, "Usage: explicit [-hvVal] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr, "Usage: explicit [-hHvVadlqRs] [-c <pct>] [-f <file>] [-m <MB>] [-M <KB>]\n\t\t[-n <probes>] [-o <order>] [-r <KB>] [-t <dir>] [-x <pct>]\n");
+#elif TLSF
+    fprintf(stderr, "Usage: tlsf [-hHvValR] [-c <pct>] [-f <file>] [-m <MB>] [-M <KB>]\n\t\t[-r <KB>] [-t <dir>]\n");
 #endif
     fprintf(stderr, "Options\n");
+#ifdef EXPLICIT
+    fprintf(stderr, "\t-d         Search a dense index of the free blocks.\n");
+#endif
+#ifdef IMPLICIT
+    fprintf(stderr, "\t-b         Skip allocated blocks with a bitmap of free blocks.\n");
+#endif
+    fprintf(stderr, "\t-c <pct>   Grow the heap by <pct>%% of its size instead of 4KB.\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
+    fprintf(stderr, "\t-H         Run the traces again with the heap in huge pages.\n");
+#ifdef IMPLICIT
+    fprintf(stderr, "\t-i         Find first fit blocks with a tree over the heap.\n");
+#endif
     fprintf(stderr, "\t-l         Run libc malloc as well.\n");
+    fprintf(stderr, "\t-m <MB>    Limit the heap to <MB> megabytes (%d).\n", MAX_HEAP >> 20);
+#ifdef IMPLICIT
+    fprintf(stderr, "\t           -b and -i only work up to the default\n");
+#elif EXPLICIT
+    fprintf(stderr, "\t           -d and -s only work up to the default\n");
+#endif
+    fprintf(stderr, "\t-M <KB>    Give requests of at least <KB> KB a mapping of their own.\n");
+#ifndef TLSF
+    fprintf(stderr, "\t-n <n>     Good fit looks at no more than <n> free blocks (8).\n");
+#endif
+#ifdef EXPLICIT
+    fprintf(stderr, "\t-o <order> Where freed blocks go in the free lists.\n");
+    fprintf(stderr, "\t           lifo (default, at the front) or addr\n");
+#endif
+#ifndef TLSF
+    fprintf(stderr, "\t-q         Keep small freed blocks in fast bins.\n");
+#endif
+    fprintf(stderr, "\t-r <KB>    Give free blocks of at least <KB> KB back to the OS.\n");
+    fprintf(stderr, "\t-R         Time realloc growing large blocks, in the heap and mapped.\n");
+#ifdef EXPLICIT
+    fprintf(stderr, "\t-s         Use slabs for requests of up to 64 bytes.\n");
+#endif
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-w <fit>   Which fit strategy to use.\n");
-    fprintf(stderr, "\t           first (default), next, or best\n");
+#ifdef IMPLICIT
+    fprintf(stderr, "\t           first (default), next, best, or good\n");
+#elif EXPLICIT
+    fprintf(stderr, "\t           first (default), next, best, seg, or good\n");
+#elif TLSF
+    fprintf(stderr, "\t           ignored; TLSF always uses good fit\n");
+#endif
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
+#ifndef TLSF
+    fprintf(stderr, "\t-x <pct>   Good fit takes a block at most <pct>%% too big (10).\n");
+#endif
 }
@@ -9,6 +9,23 @@
 
 void parseArgs(int argc, char * argv[]);
 void addressCompare(void * correct, void * returned);
+void startOver();
+void makeHoles(void * holes[], size_t sizes[], int n);
+void startOver();
+void startWithHoles(int fit, void * holes[], size_t sizes[], int n);
+void runTest(void (*test)());
+void testBestFit();
+void testSegFit();
+void testNextFit();
+void testMaxFree();
+void testIndex();
+void testGrowth();
+void testAddrOrder();
+void testFastBins();
+void testSlabs();
+void testGoodFit();
+void testTrim();
+void testMmap();
 void usage();
 
 int main(int argc, char * argv[])
@@ -44,9 +61,267 @@ int main(int argc, char * argv[])
    mm_free(bp2);
    printBlocks();
    printFreeList();   //bp1 and bp2 blocks should be coalesced
+
+   //Each of these sets up the policy it tests on a new heap and
+   //runTest puts the old policies back when it is done.
+   runTest(testBestFit);
+   runTest(testSegFit);
+   runTest(testNextFit);
+   runTest(testMaxFree);
+   runTest(testIndex);
+   runTest(testGrowth);
+   runTest(testAddrOrder);
+   runTest(testFastBins);
+   runTest(testSlabs);
+   runTest(testGoodFit);
+   runTest(testTrim);
+   runTest(testMmap);
+
+   printf("Explicit List Tester passed\n");
    return 0;
 }
 
+/*
+ * startOver - Throws the heap away and starts a new one with the
+ *             policies that are set now.
+ */
+void startOver()
+{
+   mem_reset_brk();
+   mm_init();
+}
+
+/*
+ * makeHoles - Allocates n blocks of sizes[i] bytes with a small block
+ *             after each one and frees them in order, so they become n
+ *             free blocks that can't be coalesced.  sizes should end
+ *             with 8 so each block is sizes[i] + 8 bytes.
+ */
+void makeHoles(void * holes[], size_t sizes[], int n)
+{
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      holes[i] = mm_malloc(sizes[i]);
+      mm_malloc(0x18);
+   }
+   for (i = 0; i < n; i++)
+      mm_free(holes[i]);
+}
+
+/*
+ * startWithHoles - Starts a new heap with placement policy fit and
+ *                  makes n holes in it with makeHoles.
+ */
+void startWithHoles(int fit, void * holes[], size_t sizes[], int n)
+{
+   whichfit = fit;
+   startOver();
+   makeHoles(holes, sizes, n);
+}
+
+/*
+ * runTest - Calls test, which may change any of the policies, and
+ *           puts all of them back afterwards.
+ */
+void runTest(void (*test)())
+{
+   int fit = whichfit, probes = goodProbes, slack = goodSlack;
+   int order = whichorder, bins = useFastBins, slabs = useSlabs;
+   int index = useIndex, growth = growthPercent;
+   int trim = trimThreshold, map = mmapThreshold;
+
+   test();
+   whichfit = fit;
+   goodProbes = probes;
+   goodSlack = slack;
+   whichorder = order;
+   useFastBins = bins;
+   useSlabs = slabs;
+   useIndex = index;
+   growthPercent = growth;
+   trimThreshold = trim;
+   mmapThreshold = map;
+}
+
+/*
+ * testBestFit - The best fit tree has to give the smallest free block
+ *               that fits, wherever it is in the heap and in the
+ *               order the blocks were freed.
+ */
+void testBestFit()
+{
+   void *holes[4], *bp;
+   size_t sizes[4] = {0x1f8, 0x108, 0xf8, 0x178};
+
+   startWithHoles(BESTFIT, holes, sizes, 4);
+
+   //0x110 is the only hole that fits exactly; first fit would take
+   //the 0x200 hole or the 0x180 hole freed last
+   bp = mm_malloc(0x108);
+   addressCompare(holes[1], bp);
+   //0x180 is smaller than 0x200 and the rest of the heap
+   bp = mm_malloc(0x160);
+   addressCompare(holes[3], bp);
+   //now only the 0x200 hole and the rest of the heap are left
+   bp = mm_malloc(0x1a8);
+   addressCompare(holes[0], bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testSegFit - Segregated fit looks in the list for the size class of
+ *              the request first, so it takes a small hole that one
+ *              list would have behind a bigger one.  When that list is
+ *              empty it goes on to the next bigger class that isn't.
+ */
+void testSegFit()
+{
+   void *holes[3], *bp;
+   size_t sizes[3] = {0x38, 0x1f8, 0x78};
+
+   startWithHoles(SEGFIT, holes, sizes, 3);
+   //one lifo list would give the 0x80 hole freed last
+   bp = mm_malloc(0x30);
+   addressCompare(holes[0], bp);
+   //the 0x80 hole is in a smaller class than the 0x200 one
+   bp = mm_malloc(0x30);
+   addressCompare(holes[2], bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testNextFit - Next fit starts where the last search stopped instead
+ *               of at the front of the list.  Taking a whole block
+ *               moves the rover to the block after it, and at the end
+ *               of the list the search wraps around to the front.
+ */
+void testNextFit()
+{
+   void *holes[3], *bp;
+   size_t sizes[3] = {0xf8, 0x1f8, 0xf8};
+
+   //the list is the 0x100, 0x200 and 0x100 holes and then the rest
+   //of the heap, which the rover is still on
+   startWithHoles(NEXTFIT, holes, sizes, 3);
+   //first fit would take the 0x100 hole at the front
+   bp = mm_malloc(0x78);
+   addressCompare((char *)holes[2] + 0x120, bp);
+   //taking the rest of the heap leaves the rover at the end of
+   //the list, so the search wraps around to the 0x200 hole
+   mm_malloc(0xc18);
+   bp = mm_malloc(0x1f8);
+   addressCompare(holes[1], bp);
+   //and goes on from the hole after it
+   bp = mm_malloc(0xf8);
+   addressCompare(holes[0], bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testMaxFree - A request bigger than every free block grows the heap
+ *               right away.  Once a free block gets big enough for it
+ *               by coalescing, the same request has to find that block.
+ */
+void testMaxFree()
+{
+   char *bp1, *bp2, *bp3, *bp;
+
+   whichfit = FIRSTFIT;
+   startOver();
+   //bp1 takes the first 0x1000 bytes of the heap, and bp3 keeps bp2
+   //from being the last block
+   bp1 = mm_malloc(0xff8);
+   bp2 = mm_malloc(0xff8);
+   bp3 = mm_malloc(0x18);
+   mm_free(bp1);
+   //neither the 0x1000 hole nor the free block at the end fits, so
+   //the block at the end grows
+   bp = mm_malloc(0x1ff8);
+   addressCompare(bp3 + 0x20, bp);
+   //bp1 and bp2 are one 0x2000 hole now
+   mm_free(bp2);
+   bp = mm_malloc(0x1ff8);
+   addressCompare(bp1, bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testIndex - Best fit with the dense index compares 8 sizes at a time.
+ *             It has to find the one block that fits best when that
+ *             block isn't in the first 8 entries, and mm_check compares
+ *             the index with the heap.
+ */
+void testIndex()
+{
+   void *holes[20], *bp;
+   size_t sizes[20];
+   int i;
+
+   for (i = 0; i < 20; i++)
+      sizes[i] = 0xf8;
+   //only this hole and the rest of the heap are big enough
+   sizes[10] = 0x1f8;
+   useIndex = 1;
+   startWithHoles(BESTFIT, holes, sizes, 20);
+   if (!mm_check()) exit(0);
+   bp = mm_malloc(0x1f8);
+   addressCompare(holes[10], bp);
+   //all the 0x100 holes fit this one as well as each other
+   bp = mm_malloc(0xf8);
+   for (i = 0; i < 20 && (i == 10 || holes[i] != bp); i++)
+      ;
+   if (i == 20)
+   {
+      printf("Index placement failed.\n");
+      printf("%p isn't one of the 0x100 holes\n", bp);
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testGrowth - A request that doesn't fit grows the heap only by what
+ *              the free block at its end is missing.  With growthPercent
+ *              set, a full heap grows by that percent of its size instead
+ *              of by one chunk.
+ */
+void testGrowth()
+{
+   char *bp1, *bp;
+   size_t size;
+
+   whichfit = FIRSTFIT;
+   startOver();
+   //the 0x800 bytes after bp1 are the last block
+   bp1 = mm_malloc(0x7f8);
+   size = mem_heapsize();
+   bp = mm_malloc(0xbf8);
+   addressCompare(bp1 + 0x800, bp);
+   if (mem_heapsize() != size + 0x400)
+   {
+      printf("Growth failed.\n");
+      printf("the heap grew by 0x%lx bytes instead of 0x400\n",
+             (unsigned long)(mem_heapsize() - size));
+      exit(0);
+   }
+
+   //the heap is full now; without growthPercent it would grow by
+   //a 0x1000 byte chunk
+   growthPercent = 100;
+   size = mem_heapsize();
+   mm_malloc(0x18);
+   if (mem_heapsize() - size <= 0x1000)
+   {
+      printf("Growth failed.\n");
+      printf("a 0x%lx byte heap grew by only 0x%lx bytes\n",
+             (unsigned long)size, (unsigned long)(mem_heapsize() - size));
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
 /* 
  * addressCompare - Takes two addresses as input and compares them.
  *                  If the addresses don't match, an error message
@@ -59,8 +334,10 @@ void addressCompare(void * correct, void * returned)
       if (whichfit == FIRSTFIT) printf("First fit placement failed.\n");
       if (whichfit == NEXTFIT) printf("Next fit placement failed.\n");
       if (whichfit == BESTFIT) printf("Best fit placement failed.\n");
-      printf("Should have picked: %x \n", (unsigned int) correct);
-      printf("Instead chose: %x\n", (unsigned int) returned);
+      if (whichfit == SEGFIT) printf("Segregated fit placement failed.\n");
+      if (whichfit == GOODFIT) printf("Good fit placement failed.\n");
+      printf("Should have picked: %p \n", correct);
+      printf("Instead chose: %p\n", returned);
       exit(0);
    }
 }
@@ -88,19 +365,226 @@ void parseArgs(int argc, char * argv[])
       printf("Explicit List Tester\n");
       printf("Using best fit placement strategy\n");
       whichfit = BESTFIT;
+   } else if (argc > 2 && !strcmp(argv[1], "-w") && !strcmp(argv[2], "seg"))
+   {
+      printf("Explicit List Tester\n");
+      printf("Using segregated fit placement strategy\n");
+      whichfit = SEGFIT;
    } else if (argc != 1)
    {
       usage();
    }
 }
 
+/*
+ * testAddrOrder - With address ordered lists, blocks freed in any order
+ *                 are found lowest address first by first fit.  mm_check
+ *                 also checks the order of the list.
+ */
+void testAddrOrder()
+{
+   void *holes[4], *bp;
+   int i;
+
+   whichfit = FIRSTFIT;
+   whichorder = ADDRORDER;
+   startOver();
+   for (i = 0; i < 4; i++)
+   {
+      holes[i] = mm_malloc(0xf8);
+      mm_malloc(0x18);
+   }
+   //lifo lists would hand these back as 1, 3, 0, 2
+   mm_free(holes[2]);
+   mm_free(holes[0]);
+   mm_free(holes[3]);
+   mm_free(holes[1]);
+   if (!mm_check()) exit(0);
+
+   for (i = 0; i < 4; i++)
+   {
+      bp = mm_malloc(0xf8);
+      addressCompare(holes[i], bp);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testFastBins - A small block freed into a fast bin isn't coalesced
+ *                with the one next to it, and the next request of its
+ *                size gets the block freed last.
+ */
+void testFastBins()
+{
+   void *bp1, *bp2, *bp;
+
+   whichfit = FIRSTFIT;
+   useFastBins = 1;
+   startOver();
+   bp1 = mm_malloc(0x28);
+   bp2 = mm_malloc(0x28);
+   mm_malloc(0x18);
+   //without fast bins these two would be one free block at bp1
+   mm_free(bp1);
+   mm_free(bp2);
+   if (!mm_check()) exit(0);
+
+   bp = mm_malloc(0x28);
+   addressCompare(bp2, bp);
+   bp = mm_malloc(0x28);
+   addressCompare(bp1, bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testSlabs - Small objects of one size are packed next to each other
+ *             in a slab with no header, and objects of another size go
+ *             in a slab of their own.  A freed object is used again.
+ */
+void testSlabs()
+{
+   char *bp1, *bp2, *bp3, *bp;
+
+   useSlabs = 1;
+   startOver();
+   //blocks would be 16 bytes apart
+   bp1 = mm_malloc(8);
+   bp2 = mm_malloc(8);
+   addressCompare(bp1 + 8, bp2);
+   bp3 = mm_malloc(0x18);
+   if ((unsigned long)bp3 / 4096 == (unsigned long)bp1 / 4096)
+   {
+      printf("Slab placement failed.\n");
+      printf("%p is in the same page as %p\n", bp3, bp1);
+      exit(0);
+   }
+   mm_free(bp1);
+   bp = mm_malloc(8);
+   addressCompare(bp1, bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testGoodFit - Good fit stops after goodProbes free blocks and takes
+ *               the smallest of them that fits.  With more probes it
+ *               gets to a block that is close enough to take right away.
+ */
+void testGoodFit()
+{
+   void *holes[3], *bp;
+   size_t sizes[3] = {0x100, 0x108, 0x1f8};
+
+   //all three holes are on the same list, 0x200 first and 0x108 last;
+   //the 0x110 hole is within goodSlack of 0x108, so good fit doesn't
+   //go on to the 0x108 hole that fits exactly
+   startWithHoles(GOODFIT, holes, sizes, 3);
+   bp = mm_malloc(0x100);
+   addressCompare(holes[1], bp);
+   if (!mm_check()) exit(0);
+
+   //with one probe it takes the 0x200 hole
+   goodProbes = 1;
+   startWithHoles(GOODFIT, holes, sizes, 3);
+   bp = mm_malloc(0x100);
+   addressCompare(holes[2], bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testTrim - With trimThreshold set, a big free block at the end of the
+ *            heap is cut off, and the pages inside a big free block
+ *            anywhere else are given back and read as zeros afterwards.
+ */
+void testTrim()
+{
+   char *bp1, *bp2;
+   size_t size;
+
+   whichfit = FIRSTFIT;
+   trimThreshold = 0x2000;
+   startOver();
+   bp1 = mm_malloc(0x10000);
+   size = mem_heapsize();
+   mm_free(bp1);
+   if (mem_heapsize() >= size)
+   {
+      printf("Trim failed.\n");
+      printf("heap is still 0x%lx bytes\n", (unsigned long)mem_heapsize());
+      exit(0);
+   }
+
+   //the small block keeps this one from being the last block
+   bp1 = mm_malloc(0xfff8);
+   mm_malloc(0x18);
+   memset(bp1, 0xff, 0xfff8);
+   mm_free(bp1);
+   bp2 = mm_malloc(0xfff8);
+   addressCompare(bp1, bp2);
+   if (bp2[0x8000] != 0)
+   {
+      printf("Trim failed.\n");
+      printf("%p wasn't given back\n", bp2 + 0x8000);
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testMmap - With mmapThreshold set, a big request gets a mapping of
+ *            its own outside the heap.  It stays mapped when it grows
+ *            and the mapping goes away when it is freed.
+ */
+void testMmap()
+{
+   char *bp;
+   size_t size, copied;
+
+   mmapThreshold = 0x10000;
+   startOver();
+   size = mem_heapsize();
+   bp = mm_malloc(0x20000);
+   bp[0x1ffff] = 1;
+   if (!mem_is_mapped(bp, 0x20000) || mem_heapsize() != size)
+   {
+      printf("Mmap failed.\n");
+      printf("%p isn't in a mapping of its own\n", bp);
+      exit(0);
+   }
+   //small blocks still come from the heap
+   if (mem_is_mapped(mm_malloc(0x18), 0x18))
+   {
+      printf("Mmap failed.\n");
+      printf("a 0x18 byte request was mapped\n");
+      exit(0);
+   }
+
+   //the kernel moves the pages, so nothing is copied
+   copied = reallocCopied;
+   bp = mm_realloc(bp, 0x40000);
+   if (!mem_is_mapped(bp, 0x40000) || bp[0x1ffff] != 1 ||
+       reallocCopied != copied)
+   {
+      printf("Mmap failed.\n");
+      printf("%p wasn't remapped when it grew\n", bp);
+      exit(0);
+   }
+   mm_free(bp);
+   if (mem_mapsize() != 0)
+   {
+      printf("Mmap failed.\n");
+      printf("0x%lx bytes are still mapped\n", (unsigned long)mem_mapsize());
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
 /*
  * usage - prints usage information
  */
 void usage()
 {
    printf("Usage: explicitTester [-h | -w <fit>]\n");
-   printf("       -w <fit> is first (default), next, or best\n");
+   printf("       -w <fit> is first (default), next, best, or seg\n");
    printf("       -h prints usage information\n");
    exit(0);
 }
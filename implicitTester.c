@@ -13,6 +13,19 @@
 
 void parseArgs(int argc, char * argv[]);
 void addressCompare(void * correct, void * returned);
+void testNextFitRealloc();
+void testFastBins();
+void makeHoles(void * holes[], size_t sizes[], int n);
+void startOver();
+void startWithHoles(int fit, void * holes[], size_t sizes[], int n);
+void runTest(void (*test)());
+void testFitTree();
+void testBitmap();
+void testGoodFit();
+void testMaxFree();
+void testGrowth();
+void testTrim();
+void testMmap();
 void usage();
 
 /* 
@@ -106,9 +119,397 @@ int main(int argc, char * argv[])
    //if (whichfit == NEXTFIT)  addressCompare(..., bpX);
    //if (whichfit == BESTFIT) addressCompare(..., bpX);
 
+   if (whichfit == NEXTFIT) testNextFitRealloc();
+
+   if (!mm_check()) exit(0);
+
+   //Each of these sets up the policy it tests on a new heap and
+   //runTest puts the old policies back when it is done.
+   runTest(testFastBins);
+   runTest(testFitTree);
+   runTest(testBitmap);
+   runTest(testGoodFit);
+   runTest(testMaxFree);
+   runTest(testGrowth);
+   runTest(testTrim);
+   runTest(testMmap);
+
+   printf("Implicit List Tester passed\n");
    return 0;
 }
 
+/*
+ * testNextFitRealloc - Shrinks and grows a block in place with next fit.
+ *                      Either way the next malloc has to start at the
+ *                      free block realloc leaves after it, not inside
+ *                      the old one.
+ */
+void testNextFitRealloc()
+{
+   void *bp1, *bp2, *bp3;
+
+   //start over with one free block after the prologue
+   startOver();
+
+   //the rest of the heap is free and next fit starts there
+   bp1 = mm_malloc(0x1f8);
+   //shrinking bp1 joins its tail to that free block
+   bp2 = mm_realloc(bp1, 0x88);
+   addressCompare(bp1, bp2);
+   bp3 = mm_malloc(0x88);
+   printf("Blocks after shrinking with realloc:\n");
+   printBlocks();
+   addressCompare((char *)bp1 + 0x90, bp3);
+
+   //growing bp3 takes the front of the free block after it
+   bp2 = mm_realloc(bp3, 0x1f8);
+   addressCompare(bp3, bp2);
+   bp2 = mm_malloc(0x88);
+   printf("Blocks after growing with realloc:\n");
+   printBlocks();
+   addressCompare((char *)bp3 + 0x200, bp2);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testFastBins - A small block freed into a fast bin isn't coalesced
+ *                with the one next to it, and the next request of its
+ *                size gets the block freed last.
+ */
+void testFastBins()
+{
+   void *bp1, *bp2, *bp;
+
+   whichfit = FIRSTFIT;
+   useFastBins = 1;
+   startOver();
+   bp1 = mm_malloc(0x28);
+   bp2 = mm_malloc(0x28);
+   mm_malloc(0x18);
+   //without fast bins these two would be one free block at bp1
+   mm_free(bp1);
+   mm_free(bp2);
+   if (!mm_check()) exit(0);
+
+   bp = mm_malloc(0x28);
+   addressCompare(bp2, bp);
+   bp = mm_malloc(0x28);
+   addressCompare(bp1, bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * makeHoles - Allocates n blocks of sizes[i] bytes with a small block
+ *             after each one and frees them in order, so they become n
+ *             free blocks that can't be coalesced.  sizes should end
+ *             with 8 so each block is sizes[i] + 8 bytes.
+ */
+void makeHoles(void * holes[], size_t sizes[], int n)
+{
+   int i;
+
+   for (i = 0; i < n; i++)
+   {
+      holes[i] = mm_malloc(sizes[i]);
+      mm_malloc(0x18);
+   }
+   for (i = 0; i < n; i++)
+      mm_free(holes[i]);
+}
+
+/*
+ * startOver - Throws the heap away and starts a new one with the
+ *             policies that are set now.
+ */
+void startOver()
+{
+   mem_reset_brk();
+   mm_init();
+}
+
+/*
+ * startWithHoles - Starts a new heap with placement policy fit and
+ *                  makes n holes in it with makeHoles.
+ */
+void startWithHoles(int fit, void * holes[], size_t sizes[], int n)
+{
+   whichfit = fit;
+   startOver();
+   makeHoles(holes, sizes, n);
+}
+
+/*
+ * runTest - Calls test, which may change any of the policies, and
+ *           puts all of them back afterwards.
+ */
+void runTest(void (*test)())
+{
+   int fit = whichfit, probes = goodProbes, slack = goodSlack;
+   int bins = useFastBins, tree = useFitTree, bitmap = useBitmap;
+   int growth = growthPercent;
+   int trim = trimThreshold, map = mmapThreshold;
+
+   test();
+   whichfit = fit;
+   goodProbes = probes;
+   goodSlack = slack;
+   useFastBins = bins;
+   useFitTree = tree;
+   useBitmap = bitmap;
+   growthPercent = growth;
+   trimThreshold = trim;
+   mmapThreshold = map;
+}
+
+/*
+ * testFitTree - First fit with the fit tree has to give the lowest free
+ *               block that fits, also after the tree is rebuilt for a
+ *               bigger heap.  mm_check compares the tree with the heap.
+ */
+void testFitTree()
+{
+   void *holes[3], *bp;
+   size_t sizes[3] = {0xf8, 0x2f8, 0x1f8};
+
+   useFitTree = 1;
+   startWithHoles(FIRSTFIT, holes, sizes, 3);
+   //more leaves are needed for this one
+   bp = mm_malloc(0x4000);
+   if (!mm_check()) exit(0);
+   mm_free(bp);
+
+   //the 0x300 hole is the first that fits, the 0x200 one fits best
+   bp = mm_malloc(0x1f8);
+   addressCompare(holes[1], bp);
+   bp = mm_malloc(0xf8);
+   addressCompare(holes[0], bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testBitmap - With the bitmap the walks jump from free block to free
+ *              block.  They still have to land on the same blocks as
+ *              first fit and best fit would without it.
+ */
+void testBitmap()
+{
+   void *holes[3], *bp;
+   size_t sizes[3] = {0xf8, 0x2f8, 0x1f8};
+
+   useBitmap = 1;
+   whichfit = FIRSTFIT;
+   startOver();
+   //whole words of the map with nothing free before the holes
+   mm_malloc(0x7f8);
+   makeHoles(holes, sizes, 3);
+   if (!mm_check()) exit(0);
+   bp = mm_malloc(0x1f8);
+   addressCompare(holes[1], bp);
+
+   whichfit = BESTFIT;
+   startOver();
+   mm_malloc(0x7f8);
+   makeHoles(holes, sizes, 3);
+   bp = mm_malloc(0x1f8);
+   addressCompare(holes[2], bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testGoodFit - Good fit starts at current and stops after goodProbes
+ *               free blocks, taking the smallest of them that fits.
+ *               With more probes it gets to a block that is close
+ *               enough to take right away.
+ */
+void testGoodFit()
+{
+   void *holes[3], *bp, *end;
+   size_t sizes[3] = {0x1f8, 0x108, 0x100};
+
+   //the 0x110 hole is within goodSlack of 0x108, so good fit doesn't
+   //go on to the 0x108 hole that fits exactly
+   startWithHoles(GOODFIT, holes, sizes, 3);
+   bp = mm_malloc(0x100);
+   addressCompare(holes[1], bp);
+   if (!mm_check()) exit(0);
+
+   //current is at the rest of the heap, then it wraps to the 0x200 hole
+   goodProbes = 2;
+   startWithHoles(GOODFIT, holes, sizes, 3);
+   bp = mm_malloc(0x100);
+   addressCompare(holes[0], bp);
+
+   //with the rest of the first chunk allocated, the search wraps
+   //to the 0x50 hole and stops there, so the heap grows even though
+   //the 0x200 hole after it would do
+   goodProbes = 1;
+   sizes[0] = 0x48;
+   sizes[1] = 0x1f8;
+   startWithHoles(GOODFIT, holes, sizes, 2);
+   mm_malloc(0xd68);
+   end = (char *)mem_heap_hi() + 1;
+   bp = mm_malloc(0x100);
+   addressCompare(end, bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testTrim - With trimThreshold set, a big free block at the end of the
+ *            heap is cut off, and the pages inside a big free block
+ *            anywhere else are given back and read as zeros afterwards.
+ */
+void testTrim()
+{
+   char *bp1, *bp2;
+   size_t size;
+
+   whichfit = FIRSTFIT;
+   trimThreshold = 0x2000;
+   startOver();
+   bp1 = mm_malloc(0x10000);
+   size = mem_heapsize();
+   mm_free(bp1);
+   if (mem_heapsize() >= size)
+   {
+      printf("Trim failed.\n");
+      printf("heap is still 0x%lx bytes\n", (unsigned long)mem_heapsize());
+      exit(0);
+   }
+
+   //the small block keeps this one from being the last block
+   bp1 = mm_malloc(0xfff8);
+   mm_malloc(0x18);
+   memset(bp1, 0xff, 0xfff8);
+   mm_free(bp1);
+   bp2 = mm_malloc(0xfff8);
+   addressCompare(bp1, bp2);
+   if (bp2[0x8000] != 0)
+   {
+      printf("Trim failed.\n");
+      printf("%p wasn't given back\n", bp2 + 0x8000);
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testMmap - With mmapThreshold set, a big request gets a mapping of
+ *            its own outside the heap.  It stays mapped when it grows
+ *            and the mapping goes away when it is freed.
+ */
+void testMmap()
+{
+   char *bp;
+   size_t size, copied;
+
+   mmapThreshold = 0x10000;
+   startOver();
+   size = mem_heapsize();
+   bp = mm_malloc(0x20000);
+   bp[0x1ffff] = 1;
+   if (!mem_is_mapped(bp, 0x20000) || mem_heapsize() != size)
+   {
+      printf("Mmap failed.\n");
+      printf("%p isn't in a mapping of its own\n", bp);
+      exit(0);
+   }
+   //small blocks still come from the heap
+   if (mem_is_mapped(mm_malloc(0x18), 0x18))
+   {
+      printf("Mmap failed.\n");
+      printf("a 0x18 byte request was mapped\n");
+      exit(0);
+   }
+
+   //the kernel moves the pages, so nothing is copied
+   copied = reallocCopied;
+   bp = mm_realloc(bp, 0x40000);
+   if (!mem_is_mapped(bp, 0x40000) || bp[0x1ffff] != 1 ||
+       reallocCopied != copied)
+   {
+      printf("Mmap failed.\n");
+      printf("%p wasn't remapped when it grew\n", bp);
+      exit(0);
+   }
+   mm_free(bp);
+   if (mem_mapsize() != 0)
+   {
+      printf("Mmap failed.\n");
+      printf("0x%lx bytes are still mapped\n", (unsigned long)mem_mapsize());
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testMaxFree - A request bigger than every free block grows the heap
+ *               right away.  Once a free block gets big enough for it
+ *               by coalescing, the same request has to find that block.
+ */
+void testMaxFree()
+{
+   char *bp1, *bp2, *bp3, *bp;
+
+   whichfit = FIRSTFIT;
+   startOver();
+   //bp1 takes the first 0x1000 bytes of the heap, and bp3 keeps bp2
+   //from being the last block
+   bp1 = mm_malloc(0xff8);
+   bp2 = mm_malloc(0xff8);
+   bp3 = mm_malloc(0x18);
+   mm_free(bp1);
+   //neither the 0x1000 hole nor the free block at the end fits, so
+   //the block at the end grows
+   bp = mm_malloc(0x1ff8);
+   addressCompare(bp3 + 0x20, bp);
+   //bp1 and bp2 are one 0x2000 hole now
+   mm_free(bp2);
+   bp = mm_malloc(0x1ff8);
+   addressCompare(bp1, bp);
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testGrowth - A request that doesn't fit grows the heap only by what
+ *              the free block at its end is missing.  With growthPercent
+ *              set, a full heap grows by that percent of its size instead
+ *              of by one chunk.
+ */
+void testGrowth()
+{
+   char *bp1, *bp;
+   size_t size;
+
+   whichfit = FIRSTFIT;
+   startOver();
+   //the 0x800 bytes after bp1 are the last block
+   bp1 = mm_malloc(0x7f8);
+   size = mem_heapsize();
+   bp = mm_malloc(0xbf8);
+   addressCompare(bp1 + 0x800, bp);
+   if (mem_heapsize() != size + 0x400)
+   {
+      printf("Growth failed.\n");
+      printf("the heap grew by 0x%lx bytes instead of 0x400\n",
+             (unsigned long)(mem_heapsize() - size));
+      exit(0);
+   }
+
+   //the heap is full now; without growthPercent it would grow by
+   //a 0x1000 byte chunk
+   growthPercent = 100;
+   size = mem_heapsize();
+   mm_malloc(0x18);
+   if (mem_heapsize() - size <= 0x1000)
+   {
+      printf("Growth failed.\n");
+      printf("a 0x%lx byte heap grew by only 0x%lx bytes\n",
+             (unsigned long)size, (unsigned long)(mem_heapsize() - size));
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
 /* 
  * addressCompare - Takes two addresses as input and compares them.
  *                  If the addresses don't match, an error message
@@ -121,8 +522,9 @@ void addressCompare(void * correct, void * returned)
       if (whichfit == FIRSTFIT) printf("First fit placement failed.\n");
       if (whichfit == NEXTFIT) printf("Next fit placement failed.\n");
       if (whichfit == BESTFIT) printf("Best fit placement failed.\n");
-      printf("Should have picked: %x \n", (unsigned int) correct);
-      printf("Instead chose: %x\n", (unsigned int) returned);
+      if (whichfit == GOODFIT) printf("Good fit placement failed.\n");
+      printf("Should have picked: %p \n", correct);
+      printf("Instead chose: %p\n", returned);
       exit(0);
    }
 }
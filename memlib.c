@@ -3,6 +3,7 @@
  *            allows us to interleave calls from the student's malloc package 
  *            with the system's malloc package in libc.
  */
+#define _GNU_SOURCE /* for mremap */
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
@@ -15,23 +16,143 @@
 #include "config.h"
 
 /* private variables */
-static char *mem_start_brk;  /* points to first byte of heap */
-static char *mem_brk;        /* points to last byte of heap */
-static char *mem_max_addr;   /* largest legal heap address */ 
+/*
+ * The heap is split into MEM_ARENAS independent regions ("arenas"), each
+ * with its own break.  Arena 0 is the heap that mem_sbrk grows; the others
+ * are only used by allocators that ask for them and are set up the first
+ * time they are extended.
+ *
+ * Each arena is a range of mem_max_heap bytes of address space reserved
+ * with mmap and no access.  Pages are made readable and writable
+ * MEM_COMMIT bytes at a time as the break moves past them, so a big limit
+ * costs nothing until the heap gets that big, and the first touch of each
+ * page is a real page fault.
+ *
+ * With mem_set_hugepages the arenas start on a MEM_HUGE boundary, are
+ * marked for transparent huge pages and are committed MEM_HUGE bytes at a
+ * time, so each fault can get a whole huge page and a big heap needs far
+ * fewer TLB entries.
+ */
+#define MEM_COMMIT (1 << 16)
+#define MEM_HUGE   (1 << 21)
+
+static char *mem_start_brk[MEM_ARENAS];  /* points to first byte of each arena */
+static char *mem_brk[MEM_ARENAS];        /* points to last byte of each arena */
+static char *mem_commit_brk[MEM_ARENAS]; /* first byte that isn't committed */
+/* each arena is mem_max_heap bytes, so its largest legal address is
+   mem_start_brk[a] + mem_max_heap */
+static size_t mem_max_heap = MAX_HEAP;
+static int mem_huge;                     /* back the arenas with huge pages */
+static int mem_sbrks;                    /* calls that grew an arena */
+static size_t mem_peak;                  /* largest footprint since the reset */
+
+/*
+ * Big blocks can also get their own mappings outside the arenas with
+ * mem_map.  Each one is remembered in a slot of mem_maps so the driver
+ * can check that a payload is in one, and the first word of the mapping
+ * holds the number of its slot, so finding it never needs a search.
+ *
+ * mem_maps is reserved once with room for far more mappings than the
+ * kernel allows a process, and only the pages of slots that have been
+ * used are ever touched.  Slots below mem_map_top that were given back
+ * are kept on a stack whose head also counts its changes, so threads can
+ * map and unmap at the same time without one of them taking a slot that
+ * was popped and pushed again in the meantime.
+ */
+#define MEM_MAPS (1 << 20)
+
+static struct mem_slot {
+    char *lo;                            /* first byte, NULL if free */
+    size_t size;                         /* bytes, a multiple of the page size */
+    unsigned int next;                   /* slot under this one on the stack */
+} *mem_maps;
+static unsigned int mem_map_top;         /* slots that have ever been used */
+static unsigned long long mem_map_free;  /* count << 32 | top free slot + 1 */
+static size_t mem_mapped;                /* bytes in all the mappings */
+
+static void mem_note_peak(void);
+static void mem_unmap_all(void);
+
+/*
+ * mem_reserve - reserve address space for one arena.  Returns NULL if
+ *    there isn't enough.
+ */
+static char *mem_reserve(void)
+{
+    size_t slack = mem_huge ? MEM_HUGE : 0;
+    char *start = mmap(NULL, mem_max_heap + slack, PROT_NONE,
+		       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    char *lo;
+
+    if (start == MAP_FAILED)
+	return NULL;
+    if (mem_huge) {
+	/* line the arena up with a huge page and give back the rest */
+	lo = (char *)(((size_t)start + MEM_HUGE - 1) & ~(size_t)(MEM_HUGE - 1));
+	if (lo > start)
+	    munmap(start, lo - start);
+	munmap(lo + mem_max_heap, start + slack - lo);
+#ifdef MADV_HUGEPAGE
+	madvise(lo, mem_max_heap, MADV_HUGEPAGE);
+#endif
+	start = lo;
+    }
+    return start;
+}
+
+/*
+ * mem_set_max_heap - set the size of each arena.  Must be called
+ *    before mem_init.
+ */
+void mem_set_max_heap(size_t size)
+{
+    mem_max_heap = (size + MEM_COMMIT - 1) & ~(size_t)(MEM_COMMIT - 1);
+}
+
+/*
+ * mem_set_hugepages - back the arenas with transparent huge pages if on
+ *    is set.  Must be called before mem_init.  Returns -1 if this system
+ *    has no huge pages to ask for.
+ */
+int mem_set_hugepages(int on)
+{
+#ifdef MADV_HUGEPAGE
+    mem_huge = on;
+    return 0;
+#else
+    mem_huge = 0;
+    return on ? -1 : 0;
+#endif
+}
+
+/*
+ * mem_max_heapsize() - returns the size of each arena
+ */
+size_t mem_max_heapsize()
+{
+    return mem_max_heap;
+}
 
 /* 
  * mem_init - initialize the memory system model
  */
 void mem_init(void)
 {
-    /* allocate the storage we will use to model the available VM */
-    if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
-	fprintf(stderr, "mem_init_vm: malloc error\n");
+    /* reserve the storage we will use to model the available VM */
+    if ((mem_start_brk[0] = mem_reserve()) == NULL) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
 	exit(1);
     }
 
-    mem_max_addr = mem_start_brk + MAX_HEAP;  /* max legal heap address */
-    mem_brk = mem_start_brk;                  /* heap is empty initially */
+    mem_brk[0] = mem_commit_brk[0] = mem_start_brk[0]; /* heap is empty initially */
+
+    mem_maps = mmap(NULL, MEM_MAPS * sizeof(mem_maps[0]),
+		    PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem_maps == MAP_FAILED) {
+	fprintf(stderr, "mem_init_vm: mmap error\n");
+	exit(1);
+    }
 }
 
 /* 
@@ -39,57 +160,430 @@ void mem_init(void)
  */
 void mem_deinit(void)
 {
-    free(mem_start_brk);
+    int i;
+
+    for (i = 0; i < MEM_ARENAS; i++) {
+	if (mem_start_brk[i] != NULL)
+	    munmap(mem_start_brk[i], mem_max_heap);
+	mem_start_brk[i] = mem_brk[i] = mem_commit_brk[i] = NULL;
+    }
+    mem_unmap_all();
+    munmap(mem_maps, MEM_MAPS * sizeof(mem_maps[0]));
+    mem_maps = NULL;
 }
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_reset_brk - reset the simulated brk pointers to make empty arenas.
+ *    The pages stay committed, so only the first run over a heap pays
+ *    for touching them.
  */
 void mem_reset_brk()
 {
-    mem_brk = mem_start_brk;
+    int i;
+
+    for (i = 0; i < MEM_ARENAS; i++)
+	mem_brk[i] = mem_start_brk[i];
+    mem_sbrks = 0;
+    mem_peak = 0;
+
+    /* the mappings belong to the old heap too */
+    mem_unmap_all();
+}
+
+/*
+ * mem_unmap_all - give back every mapping made by mem_map that is still
+ *    in mem_maps, and every slot with it
+ */
+static void mem_unmap_all(void)
+{
+    char *lo;
+    unsigned int i;
+
+    for (i = 0; i < mem_map_top; i++)
+	if ((lo = mem_maps[i].lo) != NULL) {
+	    mem_maps[i].lo = NULL;
+	    munmap(lo, mem_maps[i].size);
+	}
+    mem_map_top = 0;
+    mem_map_free = 0;
+    mem_mapped = 0;
+}
+
+/*
+ * mem_arena_open - reserve the storage of arena a the first time it is
+ *    used and return its first byte.  Two threads may race to do this;
+ *    the loser gives its copy back.  Returns NULL if there is no memory.
+ */
+static char *mem_arena_open(int a)
+{
+    char *start, *expected = NULL;
+
+    if ((start = __atomic_load_n(&mem_start_brk[a], __ATOMIC_ACQUIRE)) == NULL) {
+	if ((start = mem_reserve()) == NULL)
+	    return NULL;
+	if (!__atomic_compare_exchange_n(&mem_start_brk[a], &expected, start, 0,
+					 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	    munmap(start, mem_max_heap);
+	    start = expected;
+	}
+    }
+    /* the break of a new arena starts at its first byte */
+    expected = NULL;
+    __atomic_compare_exchange_n(&mem_brk[a], &expected, start, 0,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    expected = NULL;
+    __atomic_compare_exchange_n(&mem_commit_brk[a], &expected, start, 0,
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return start;
+}
+
+/*
+ * mem_commit - make the pages of arena a up to end usable.  Several
+ *    threads may commit the same pages at once; that's harmless.
+ *    Returns -1 if the pages can't be committed.
+ */
+static int mem_commit(int a, char *end)
+{
+    char *start = mem_start_brk[a];
+    char *committed = __atomic_load_n(&mem_commit_brk[a], __ATOMIC_ACQUIRE);
+    size_t unit = mem_huge ? MEM_HUGE : MEM_COMMIT;
+    char *top;
+
+    if (end <= committed)
+	return 0;
+    top = start + (((end - start) + unit - 1) & ~(unit - 1));
+    if (top > start + mem_max_heap)
+	top = start + mem_max_heap;
+    if (mprotect(committed, top - committed, PROT_READ | PROT_WRITE) < 0)
+	return -1;
+    /* only ever move the committed mark up */
+    while (committed < top &&
+	   !__atomic_compare_exchange_n(&mem_commit_brk[a], &committed, top, 0,
+					__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	;
+    return 0;
 }
 
 /* 
  * mem_sbrk - simple model of the sbrk function. Extends the heap 
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ *    by incr bytes and returns the start address of the new area.
+ *    A negative incr shrinks the heap and returns the old break.
  */
 void *mem_sbrk(int incr) 
 {
-    char *old_brk = mem_brk;
+    return mem_arena_sbrk(0, incr);
+}
 
-    if ( (incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+/*
+ * mem_arena_sbrk - extends arena a by incr bytes and returns the start
+ *    address of the new area.  The break is moved with a compare and
+ *    swap, so several threads can call mem_arena_sbrk at once.  A
+ *    negative incr shrinks the arena and gives the pages that are no
+ *    longer in it back to the OS; that must not race with a call that
+ *    grows the same arena.
+ */
+void *mem_arena_sbrk(int a, int incr)
+{
+    char *start, *old_brk;
+
+    if (a < 0 || a >= MEM_ARENAS || (start = mem_arena_open(a)) == NULL) {
 	errno = ENOMEM;
-	fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
+	fprintf(stderr, "ERROR: mem_sbrk failed. No arena %d...\n", a);
 	return (void *)-1;
     }
-    mem_brk += incr;
+
+    old_brk = __atomic_load_n(&mem_brk[a], __ATOMIC_RELAXED);
+    do {
+	if (incr < 0 && old_brk + incr < start) {
+	    errno = EINVAL;
+	    fprintf(stderr, "ERROR: mem_sbrk failed. Shrunk below the heap...\n");
+	    return (void *)-1;
+	}
+	if ( (incr > 0) && (((size_t)(old_brk - start) + incr > mem_max_heap)
+			    || mem_commit(a, old_brk + incr) < 0)) {
+	    errno = ENOMEM;
+	    fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
+	    return (void *)-1;
+	}
+    } while (!__atomic_compare_exchange_n(&mem_brk[a], &old_brk, old_brk + incr,
+					  0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    if (incr < 0) {
+	mem_release(old_brk + incr, -incr);
+	return (void *)old_brk;
+    }
+    __atomic_fetch_add(&mem_sbrks, 1, __ATOMIC_RELAXED);
+    mem_note_peak();
     return (void *)old_brk;
 }
 
 /*
- * mem_heap_lo - return address of the first heap byte
+ * mem_note_peak - raise mem_peak to the current footprint if it is
+ *    bigger
+ */
+static void mem_note_peak(void)
+{
+    size_t size = mem_heapsize() + __atomic_load_n(&mem_mapped, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&mem_peak, __ATOMIC_RELAXED);
+
+    while (size > peak &&
+	   !__atomic_compare_exchange_n(&mem_peak, &peak, size, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	;
+}
+
+/*
+ * mem_slot_get - take a slot of mem_maps.  Returns -1 if all of them
+ *    are in use.
+ */
+static long mem_slot_get(void)
+{
+    unsigned long long head = __atomic_load_n(&mem_map_free, __ATOMIC_ACQUIRE);
+    unsigned int i;
+
+    while ((unsigned int)head != 0) {
+	i = (unsigned int)head - 1;
+	if (__atomic_compare_exchange_n(&mem_map_free, &head,
+					((head >> 32) + 1) << 32 | mem_maps[i].next,
+					0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	    return i;
+    }
+    i = __atomic_fetch_add(&mem_map_top, 1, __ATOMIC_RELAXED);
+    if (i >= MEM_MAPS) {
+	__atomic_fetch_sub(&mem_map_top, 1, __ATOMIC_RELAXED);
+	return -1;
+    }
+    return i;
+}
+
+/*
+ * mem_slot_put - give slot i of mem_maps back
+ */
+static void mem_slot_put(unsigned int i)
+{
+    unsigned long long head = __atomic_load_n(&mem_map_free, __ATOMIC_RELAXED);
+
+    do
+	mem_maps[i].next = (unsigned int)head;
+    while (!__atomic_compare_exchange_n(&mem_map_free, &head,
+					((head >> 32) + 1) << 32 | (i + 1),
+					0, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+ * mem_slot_of - returns the slot of the mapping that starts at lo, or -1
+ *    if lo doesn't start one.  lo must be readable.
+ */
+static long mem_slot_of(void *lo)
+{
+    unsigned int i = *(unsigned int *)lo;
+
+    /* mem_map_top can be past the end for a moment when it runs out */
+    if (i >= MEM_MAPS ||
+	i >= __atomic_load_n(&mem_map_top, __ATOMIC_ACQUIRE) ||
+	__atomic_load_n(&mem_maps[i].lo, __ATOMIC_ACQUIRE) != lo)
+	return -1;
+    return i;
+}
+
+/*
+ * mem_map - give a new page aligned mapping of at least size bytes
+ *    outside the heap.  Its first word belongs to memlib; the caller
+ *    must leave it alone until it calls mem_unmap.  Returns NULL if
+ *    there is no memory or no slot left in mem_maps, so the caller can
+ *    use the heap instead.
+ */
+void *mem_map(size_t size)
+{
+    size_t pagesize = mem_pagesize();
+    char *lo;
+    long i;
+
+    size = (size + pagesize - 1) & ~(pagesize - 1);
+    lo = mmap(NULL, size, PROT_READ | PROT_WRITE,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (lo == MAP_FAILED)
+	return NULL;
+    if ((i = mem_slot_get()) < 0) {
+	munmap(lo, size);
+	return NULL;
+    }
+
+    *(unsigned int *)lo = i;
+    mem_maps[i].size = size;
+    __atomic_store_n(&mem_maps[i].lo, lo, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&mem_mapped, size, __ATOMIC_RELAXED);
+    mem_note_peak();
+    return lo;
+}
+
+/*
+ * mem_unmap - give back the mapping of size bytes at lo made by mem_map
+ */
+void mem_unmap(void *lo, size_t size)
+{
+    long i;
+
+    size = (size + mem_pagesize() - 1) & ~(mem_pagesize() - 1);
+    if ((i = mem_slot_of(lo)) < 0)
+	return;
+    __atomic_store_n(&mem_maps[i].lo, NULL, __ATOMIC_RELEASE);
+    munmap(lo, size);
+    __atomic_fetch_sub(&mem_mapped, size, __ATOMIC_RELAXED);
+    mem_slot_put(i);
+}
+
+/*
+ * mem_remap - resize the mapping of oldsize bytes at lo made by mem_map
+ *    to newsize bytes with mremap.  The kernel moves the pages instead
+ *    of copying them, and may move the mapping.  Returns the new start
+ *    of the mapping, or NULL if it can't be resized.
+ */
+void *mem_remap(void *lo, size_t oldsize, size_t newsize)
+{
+    size_t pagesize = mem_pagesize();
+    char *newlo;
+    long i;
+
+    oldsize = (oldsize + pagesize - 1) & ~(pagesize - 1);
+    newsize = (newsize + pagesize - 1) & ~(pagesize - 1);
+    if ((i = mem_slot_of(lo)) < 0)
+	return NULL;
+
+    newlo = mremap(lo, oldsize, newsize, MREMAP_MAYMOVE);
+    if (newlo == MAP_FAILED)
+	return NULL;
+    /* the slot number moved with the pages, and only this thread has
+       the block, so nobody else uses the slot */
+    mem_maps[i].size = newsize;
+    __atomic_store_n(&mem_maps[i].lo, newlo, __ATOMIC_RELEASE);
+    if (newsize > oldsize)
+	__atomic_fetch_add(&mem_mapped, newsize - oldsize, __ATOMIC_RELAXED);
+    else
+	__atomic_fetch_sub(&mem_mapped, oldsize - newsize, __ATOMIC_RELAXED);
+    mem_note_peak();
+    return newlo;
+}
+
+/*
+ * mem_is_mapped - returns 1 if the size bytes at p are all in one
+ *    mapping made by mem_map.  p must be readable and in the first page
+ *    of its mapping, as the payload of a mapped block is.
+ */
+int mem_is_mapped(void *p, size_t size)
+{
+    char *lo = (char *)((unsigned long)p & ~(mem_pagesize() - 1));
+    long i;
+
+    if (p == NULL || (i = mem_slot_of(lo)) < 0)
+	return 0;
+    return (char *)p + size <= lo + mem_maps[i].size;
+}
+
+/*
+ * mem_mapsize() - returns the bytes in all the mappings made by mem_map
+ */
+size_t mem_mapsize()
+{
+    return __atomic_load_n(&mem_mapped, __ATOMIC_RELAXED);
+}
+
+/*
+ * mem_release - tells the OS it can take back the whole pages between
+ *    lo and lo + size.  They stay part of the heap and read as zeros
+ *    the next time they are touched.  Returns the bytes given back.
+ */
+size_t mem_release(void *lo, size_t size)
+{
+    size_t pagesize = mem_pagesize();
+    char *first = (char *)(((unsigned long)lo + pagesize - 1) & ~(pagesize - 1));
+    char *last = (char *)(((unsigned long)lo + size) & ~(pagesize - 1));
+
+    if (last <= first)
+	return 0;
+    madvise(first, last - first, MADV_DONTNEED);
+    return last - first;
+}
+
+/*
+ * mem_arena_lo - return address of the first byte of arena a, or NULL
+ *    if the arena has not been used yet
+ */
+void *mem_arena_lo(int a)
+{
+    return (void *)__atomic_load_n(&mem_start_brk[a], __ATOMIC_ACQUIRE);
+}
+
+/*
+ * mem_arena_hi - return address of the last byte of arena a
+ */
+void *mem_arena_hi(int a)
+{
+    return (void *)(__atomic_load_n(&mem_brk[a], __ATOMIC_ACQUIRE) - 1);
+}
+
+/*
+ * mem_arena_of - return the arena that address p is in, or -1 if p is
+ *    not in any arena
+ */
+int mem_arena_of(void *p)
+{
+    int i;
+    char *start;
+
+    for (i = 0; i < MEM_ARENAS; i++) {
+	start = __atomic_load_n(&mem_start_brk[i], __ATOMIC_ACQUIRE);
+	if (start != NULL && (char *)p >= start && (char *)p < start + mem_max_heap)
+	    return i;
+    }
+    return -1;
+}
+
+/*
+ * mem_heap_lo - return address of the first heap byte (of arena 0)
  */
 void *mem_heap_lo()
 {
-    return (void *)mem_start_brk;
+    return (void *)mem_start_brk[0];
 }
 
 /* 
- * mem_heap_hi - return address of last heap byte
+ * mem_heap_hi - return address of last heap byte (of arena 0)
  */
 void *mem_heap_hi()
 {
-    return (void *)(mem_brk - 1);
+    return (void *)(__atomic_load_n(&mem_brk[0], __ATOMIC_ACQUIRE) - 1);
 }
 
 /*
- * mem_heapsize() - returns the heap size in bytes
+ * mem_heapsize() - returns the heap size in bytes, summed over all arenas
  */
 size_t mem_heapsize() 
 {
-    return (size_t)(mem_brk - mem_start_brk);
+    size_t size = 0;
+    int i;
+
+    for (i = 0; i < MEM_ARENAS; i++)
+	size += (size_t)(__atomic_load_n(&mem_brk[i], __ATOMIC_ACQUIRE) - mem_start_brk[i]);
+    return size;
+}
+
+/*
+ * mem_sbrk_calls() - returns the number of times an arena was extended
+ *    since the last mem_reset_brk
+ */
+int mem_sbrk_calls()
+{
+    return __atomic_load_n(&mem_sbrks, __ATOMIC_RELAXED);
+}
+
+/*
+ * mem_peak_footprint() - returns the largest number of bytes in all the
+ *    arenas and mappings at once since the last mem_reset_brk
+ */
+size_t mem_peak_footprint()
+{
+    return __atomic_load_n(&mem_peak, __ATOMIC_RELAXED);
 }
 
 /*
@@ -1,11 +1,29 @@
 #include <unistd.h>
 
+/* number of independent heap regions; arena 0 is the one mem_sbrk grows */
+#define MEM_ARENAS 8
+
+void mem_set_max_heap(size_t size);
+int mem_set_hugepages(int on);
 void mem_init(void);               
 void mem_deinit(void);
 void *mem_sbrk(int incr);
+size_t mem_release(void *lo, size_t size);
 void mem_reset_brk(void); 
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
+size_t mem_max_heapsize(void);
+size_t mem_peak_footprint(void);
 size_t mem_pagesize(void);
+int mem_sbrk_calls(void);
+void *mem_arena_sbrk(int arena, int incr);
+void *mem_arena_lo(int arena);
+void *mem_arena_hi(int arena);
+int mem_arena_of(void *p);
+void *mem_map(size_t size);
+void mem_unmap(void *lo, size_t size);
+void *mem_remap(void *lo, size_t oldsize, size_t newsize);
+int mem_is_mapped(void *p, size_t size);
+size_t mem_mapsize(void);
 
@@ -23,31 +23,41 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/mman.h>
+#ifdef THREADSAFE
+#include <pthread.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "mmExplicit.h"
 #include "memlib.h"
+#include "config.h"
 /*
  * Each allocated block has the form:
  *
  *      31                     3  2  1  0
  *      ------------------------------------
- *     | s  s  s  s  ... s  s  s  0  0  1   |
+ *     | s  s  s  s  ... s  s  s  m  p  1   |
  *      ------------------------------------
  *     |                                    |
  *     |     payload and padding            |
  *     |                                    |
  *      ------------------------------------
- *     | s  s  s  s  ... s  s  s  0  0  1   |
- *      ------------------------------------
  *
- * where s are the meaningful size bits.
+ * where s are the meaningful size bits and p is set if the
+ * block before it in memory is allocated.  Allocated blocks
+ * have no footer.  m is set if the block is in a mapping of
+ * its own instead of the heap (see mapBlock); s is then the
+ * size of the mapping.  A free block is never mapped.
  *
  * If the block is empty, it has pointers to the
  * previous free block and the successor free blocks.
  *
  *      31                     3  2  1  0
  *      ------------------------------------
- *     | s  s  s  s  ... s  s  s  0  0  0   |
+ *     | s  s  s  s  ... s  s  s  0  p  0   |
  *      ------------------------------------
  *     |        predecessor free block      |
  *      ------------------------------------
@@ -59,6 +69,24 @@
  *     | s  s  s  s  ... s  s  s  0  0  0   |
  *      ------------------------------------
  *
+ * When best fit is used, free blocks of at least TREEMIN bytes are
+ * also nodes of an AVL tree ordered by size and then by address.
+ * The tree links follow the successor word:
+ *
+ *      ------------------------------------
+ *     |        predecessor free block      |
+ *      ------------------------------------
+ *     |        successor free block        |
+ *      ------------------------------------
+ *     |        left child in tree          |
+ *      ------------------------------------
+ *     |        right child in tree         |
+ *      ------------------------------------
+ *     |        parent in tree              |
+ *      ------------------------------------
+ *     |        height of subtree           |
+ *      ------------------------------------
+ *
  * In addition, the heap is organized in the following way:
  *
  * begin                                                          end
@@ -72,20 +100,81 @@
  * The allocated prologue and epilogue blocks are overhead that
  * eliminate edge conditions during coalescing.
  *
- * The code targets an X86 32-bit machine, which means double word
+ * The code runs on 32 and 64-bit X86 machines and uses double word
  * alignment.  Each block is a multiple of 8 bytes in size and the
  * address of the payload is a multiple of 8.  Headers and footers
- * are 4 bytes each.
+ * are 4 bytes each.  The links in a free block are 4 byte offsets
+ * from the start of the heap, even on a 64-bit machine.
+ *
+ * With whichorder set to ADDRORDER each free list is kept sorted by
+ * address instead of having freed blocks pushed on the front.  An address
+ * map with a bit for every 8 bytes of the arena in each list marks where
+ * the blocks of that list start, with two levels of summary bits above
+ * it.  The block a new block goes after is found with a few bit scans
+ * instead of a walk along the list.
+ *
+ * Each list has a bound on its largest block (maxFree).  It is raised
+ * whenever a bigger block is added but not lowered when one is taken
+ * out; a search that walks a whole list without finding a fit makes it
+ * exact again.  find_fit gives up right away when no list that could
+ * hold the request has a big enough bound.
+ *
+ * If useIndex is set, each arena also keeps the size and offset of every
+ * free block in two arrays.  first_fit and best_fit scan the sizes with
+ * AVX2 or SSE2 compares, 8 or 4 blocks per instruction, instead of
+ * following SUCC from one free block to the next.  The arrays aren't in
+ * list order, so first fit takes the first block in the index that fits.
+ *
+ * If useFastBins is set, freed blocks of up to FASTMAX bytes skip the
+ * free lists.  They stay marked allocated and are pushed onto a list of
+ * blocks of exactly their size (a fast bin), so the next request for that
+ * size is a pop.  The fast bins are emptied into the free lists, coalescing
+ * as usual, when a search for a free block fails.
+ *
+ * When nothing fits, an arena only grows by what the free block at its
+ * end (if there is one) is missing.  Otherwise it grows by CHUNKSIZE, or
+ * with growthPercent set by that percent of the arena size (at most
+ * CHUNKMAX), so an arena that keeps growing calls mem_sbrk less often.
+ *
+ * With trimThreshold set, freeing a block that leaves a free block of at
+ * least that many bytes gives memory back.  A free block at the end of an
+ * arena is cut down to CHUNKSIZE with a negative mem_arena_sbrk.  The pages
+ * inside any other free block, past its links, are released with
+ * mem_release; they stay in the arena and come back as zeros.
+ *
+ * If useSlabs is set, requests of up to SLABMAX bytes come from slabs
+ * instead.  A slab is a page aligned block of PAGESIZE bytes that holds
+ * objects of one size with no header or footer.  Slabs are carved
+ * SLAB_CHUNK at a time, so only one alignment gap is paid per chunk.
+ * The slab header has a bitmap of the free objects, and each arena has a
+ * bitmap of the pages that are slabs, so mm_free can tell a slab object
+ * from its address.
+ *
+ * Compiled with -DTHREADSAFE the allocator can be called from several
+ * threads.  The heap is split into NUMARENAS arenas, each a separate
+ * memlib region with its own lists and its own lock.  Threads are given
+ * arenas round robin and move to another arena when theirs is busy.  A
+ * block is always freed to the arena it is in.  Each thread also keeps
+ * a cache of blocks it freed for each block size up to TCACHE_MAXSIZE.
+ * A thread allocates from and frees to its own cache without taking a
+ * lock.  Blocks move between a cache and the arenas TCACHE_BATCH at a
+ * time.  A block freed by a thread that doesn't allocate from its arena
+ * is pushed onto that arena's remote free stack instead, so the freeing
+ * thread never waits for the owner's lock.  mm_init, mm_check and the
+ * print functions must not run while another thread is using the
+ * allocator.
  */
 
 // MACROS
 #define WSIZE 4
 #define DSIZE 8
 #define CHUNKSIZE (1 << 12)
+#define CHUNKMAX (1 << 18) // largest chunk growthPercent asks for
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
 
-// create a header or footer by ORing the size and allocation bit
+// create a header or footer by ORing the size and allocation bits
 #define PACK(size, alloc) ((size) | (alloc))
 
 // get the word stored in address p
@@ -93,6 +182,13 @@
 // store a word in memory at address p
 #define PUT(p, val) (*(unsigned int *)(p) = (val))
 
+// The free list links are stored as 4 byte offsets from the start of the
+// heap instead of as pointers, so a free block needs the same room on a
+// 64-bit machine as on a 32-bit one.  Offset 0 is the padding word at the
+// start of the heap, which is never a block, so it stands for NULL.
+#define GET_PTR(p) (GET(p) ? ar->heap_base + GET(p) : NULL)
+#define PUT_PTR(p, ptr) PUT(p, (ptr) ? (unsigned int)((char *)(ptr)-ar->heap_base) : 0)
+
 // size is going to be a multiple of 8 so ignore the lower
 // three bits when getting the size out of the header or footer
 #define GET_SIZE(p) (GET(p) & ~0x7)
@@ -100,15 +196,37 @@
 // get the allocation bit out of the header or footer
 #define GET_ALLOC(p) (GET(p) & 0x1)
 
+// bit 1 of a header is set if the previous block in memory is allocated.
+// Allocated blocks don't have a footer, so this bit is the only way to
+// tell whether the previous block is free without following PREV_BLKP.
+#define PREV_ALLOC 0x2
+#define GET_PREV_ALLOC(p) (GET(p) & PREV_ALLOC)
+// set or clear the prev-alloc bit in the header of block bp
+#define SET_PREV_ALLOC(bp) PUT(HDRP(bp), GET(HDRP(bp)) | PREV_ALLOC)
+#define CLEAR_PREV_ALLOC(bp) PUT(HDRP(bp), GET(HDRP(bp)) & ~PREV_ALLOC)
+
+// bit 2 of a header is set if the block is in a mapping of its own
+// (see mapBlock); its size is then the size of the mapping
+#define MAPPED 0x4
+#define GET_MAPPED(p) (GET(p) & MAPPED)
+// bytes of mapping a block of asize bytes needs
+#define MAP_SIZE(asize) (((asize) + WSIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1))
+
 // bp is the address of the payload
 // HDRP returns the address of the header
 #define HDRP(bp) ((char *)(bp)-WSIZE)
-// FTRP returns the address of the footer
+// FTRP returns the address of the footer; only free blocks have one
 #define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
 // PRED returns the address of the pred field
 #define PRED(bp) ((char *)(bp))
 // SUCC returns the address of the succ field
 #define SUCC(bp) ((char *)(bp) + WSIZE)
+// LEFT, RIGHT, PARENT and HEIGHT return the addresses of the tree fields
+// of a free block that is in the best fit tree
+#define LEFT(bp) ((char *)(bp) + 2 * WSIZE)
+#define RIGHT(bp) ((char *)(bp) + 3 * WSIZE)
+#define PARENT(bp) ((char *)(bp) + 4 * WSIZE)
+#define HEIGHT(bp) ((char *)(bp) + 5 * WSIZE)
 
 // bp is the pointer to the payload
 // NEXT_BLKP returns a pointer to the payload of the next block
@@ -118,143 +236,732 @@
 // PREV_BLKP returns a pointer to the payload of the previous block
 // previous in this case refers to the previous physically located block
 //(not previous in free list)
+// It reads the footer of that block, so it can only be used if the
+// previous block is free.
 #define PREV_BLKP(bp) ((char *)(bp)-GET_SIZE(((char *)(bp)-DSIZE)))
 
-// Memory Pointer
-// points to payload (footer) of first block in heap, which is prologue block
-static char *heap_listp;
-// used for next fit allocation; points to the next free block in the
-// explicit list after the last one that was allocated
-static char *current;
-// points to the first free block in explicit list
-static char *firstFree;
-// points to the last free block in explicit list
-static char *lastFree;
+// Size classes used by the segregated fit policy.  Class 0 holds the
+// 16 byte blocks, class 1 the 24 byte blocks, class 2 the 32 byte blocks
+// and every class after that holds blocks up to twice the size of the
+// previous class.  The last class holds everything bigger.
+#define NUMCLASSES 12
+#define MINBLOCK (2 * DSIZE)
+// place only splits off a leftover block of at least SPLITMIN bytes;
+// a bigger value can be picked with -DSPLITMIN when compiling
+#ifndef SPLITMIN
+#define SPLITMIN MINBLOCK
+#endif
+// smallest block that has room for the tree fields
+#define TREEMIN (4 * DSIZE)
+
+// Fast bins hold freed blocks of 16 to FASTMAX bytes, one bin per size.
+// They are linked through the pred word like a free list.
+#define FASTMAX (8 * DSIZE)
+#define NUMFAST (FASTMAX / DSIZE - 1)
+#define FAST_BIN(size) ((size) / DSIZE - 2)
+
+// The dense index of an arena holds at most INDEXMAX free blocks.  An
+// arena with more free blocks than that goes back to the lists until
+// mm_init is called again.  Two blocks never start in the same MINBLOCK
+// bytes, so IDX_SLOT finds the index entry of a block from its offset.
+#define INDEXMAX (1 << 16)
+#define IDX_SLOT(off) (ar->idx->slot[(off) / MINBLOCK])
+
+// Slabs.  The objects in a slab start after the slab header and are
+// 8, 16, 24, 32, 48 or 64 bytes.  The last word of the page is the
+// header of the next block.  A slab with no free objects is taken out
+// of the list of slabs of its size.
+#define PAGESIZE (1 << 12)
+#define SLABMAX (8 * DSIZE)
+#define NUMSLABS 6
+#define SLAB_CHUNK 4
+// enough free map words for the 500 or so 8 byte objects in a slab
+#define SLAB_WORDS 8
+#define SLAB_FIRST ((sizeof(struct slab) + DSIZE - 1) & ~(DSIZE - 1))
+#define SLAB_OBJECTS(size) ((PAGESIZE - WSIZE - SLAB_FIRST) / (size))
+// SLAB_OF returns the slab that the object at p is in
+#define SLAB_OF(p) ((struct slab *)((unsigned long)(p) & ~(unsigned long)(PAGESIZE - 1)))
+// one bit for every page an arena can have
+#define PAGE_WORDS ((MAX_HEAP / PAGESIZE + 1 + 63) / 64)
+
+// The dense index of one arena: the size and heap offset of every free
+// block, in no particular order, and the index entry of the free block
+// at each offset.  It is a few MB, so it is only mapped once useIndex is
+// set.
+struct denseIndex
+{
+   unsigned int size[INDEXMAX];
+   unsigned int off[INDEXMAX];
+   unsigned short slot[MAX_HEAP / MINBLOCK];
+};
+
+// The address map of an arena, used with ADDRORDER.  bits[c] has a bit
+// for every DSIZE bytes of the arena, set where a block in list c
+// starts.  A bit of summary[c] is set for each word of bits[c] that
+// isn't 0, and a bit of top[c] for each word of summary[c] that isn't 0.
+#define ADDR_WORDS ((MAX_HEAP / DSIZE + 63) / 64)
+#define ADDR_SUMMARY ((ADDR_WORDS + 63) / 64)
+#define ADDR_TOP ((ADDR_SUMMARY + 63) / 64)
+// the bits of a word below bit i, and the highest bit that is set
+#define BELOW(i) ((1ULL << (i)) - 1)
+#define HIGH_BIT(x) (63 - __builtin_clzll(x))
+
+struct addrMap
+{
+   unsigned long long bits[NUMCLASSES][ADDR_WORDS];
+   unsigned long long summary[NUMCLASSES][ADDR_SUMMARY];
+   unsigned long long top[NUMCLASSES][ADDR_TOP];
+};
+
+struct slab
+{
+   // the other slabs of this size that have free objects
+   struct slab *prev;
+   struct slab *next;
+   // size of the objects
+   unsigned int size;
+   // number of free objects
+   unsigned int nfree;
+   // a bit is set if that object is free
+   unsigned long long freeMap[SLAB_WORDS];
+};
+
+// The state of one heap.  The thread safe build has one arena for each
+// memlib arena, each with its own lock.  Otherwise there is just one.
+struct arena
+{
+   // points to payload (footer) of first block in heap, which is prologue
+   // block; NULL until the arena is set up
+   char *heap_listp;
+   // first byte of the heap; the free list links are offsets from here
+   char *heap_base;
+   // used for next fit allocation; points to the next free block in the
+   // explicit list after the last one that was allocated
+   char *current;
+   // points to the first free block in each explicit list
+   char *firstFree[NUMCLASSES];
+   // points to the last free block in each explicit list
+   char *lastFree[NUMCLASSES];
+   // no block in list c is bigger than maxFree[c]; raised when a block
+   // is added and made exact again when a search walks the whole list
+   size_t maxFree[NUMCLASSES];
+   // root of the best fit tree; only used with best fit
+   char *treeRoot;
+   // points to the first block in each fast bin
+   char *fastBin[NUMFAST];
+   // number of blocks in all the fast bins
+   int fastCount;
+   // slabs of each object size that have free objects
+   struct slab *slabs[NUMSLABS];
+   // pages of the last chunk that aren't slabs yet, linked through
+   // their first word
+   char *spareSlabs;
+   // a bit is set for each page of the heap that is a slab; bit 0 is
+   // the page heap_base is in
+   unsigned long long slabPages[PAGE_WORDS];
+   // the dense index, NULL until useIndex is first set; it is kept
+   // when mm_init starts a new heap.  idxCount is -1 once it is full.
+   struct denseIndex *idx;
+   int idxCount;
+   // the address map, NULL until whichorder is first ADDRORDER; it is
+   // kept and cleared when mm_init starts a new heap
+   struct addrMap *addr;
+#ifdef THREADSAFE
+   pthread_mutex_t lock;
+   // blocks and slab objects freed by threads that don't allocate from
+   // this arena.  Any thread pushes onto it without the lock; the thread
+   // holding the lock takes the whole stack at once and frees them.
+   char *remoteFree;
+#endif
+};
+
+#ifdef THREADSAFE
+#define NUMARENAS MEM_ARENAS
+#else
+#define NUMARENAS 1
+#endif
+
+static struct arena arenas[NUMARENAS];
+// the arena being worked on; every helper function uses this one.  In
+// the thread safe build it is the arena the calling thread has locked.
+#ifdef THREADSAFE
+static __thread struct arena *ar;
+#else
+static struct arena *ar = &arenas[0];
+#endif
+/*
+ * The policies can be fixed when this file is compiled, with
+ * -DFIT=<fit>, -DORDER=<order> and -DFAST=<0 or 1> (the policies target
+ * in the Makefile builds every combination).  The policy tests are then
+ * on constants, the compiler leaves out the code of the other policies,
+ * and whichfit, whichorder and useFastBins are ignored.
+ */
+#ifdef FIT
+#define WHICHFIT FIT
+#else
+#define WHICHFIT whichfit
+#endif
+#ifdef ORDER
+#define WHICHORDER ORDER
+#else
+#define WHICHORDER whichorder
+#endif
+#ifdef FAST
+#define FASTBINS FAST
+#else
+#define FASTBINS useFastBins
+#endif
+
+#ifdef FIT
+#define numClasses ((FIT == SEGFIT || FIT == GOODFIT || FIT == BESTFIT) ? \
+                    NUMCLASSES : 1)
+#define useTree (FIT == BESTFIT)
+#else
+// number of lists in use; NUMCLASSES for segregated, good and best fit,
+// otherwise every free block is kept in list 0
+static int numClasses;
+// set if the free blocks are kept in the best fit tree
+static int useTree;
+#endif
+
+#ifdef THREADSAFE
+// Thread caches.  The blocks in a cache stay marked allocated, so the
+// heap treats them like any other allocated block and never coalesces
+// with them.  A cache can hold blocks of several arenas, so they are
+// linked by full pointers in the first 8 bytes of the payload.
+#define CACHE_NEXT(bp) (*(char **)(bp))
+#define TCACHE_MAXSIZE 1024 // bigger blocks always go to the heap
+#define TCACHE_BINS (TCACHE_MAXSIZE / DSIZE - 1)
+#define TCACHE_BIN(size) ((size) / DSIZE - 2)
+#define TCACHE_MAX 8   // most blocks a thread keeps of one size
+#define TCACHE_BATCH 4 // blocks moved between a cache and the heap at once
+
+struct tcache
+{
+   char *head[TCACHE_BINS];
+   int count[TCACHE_BINS];
+   // value of heapEpoch when the cache was last emptied
+   int epoch;
+   // set once the cache will be flushed when the thread exits
+   int registered;
+};
+
+static __thread struct tcache tcache;
+// bumped by mm_init; cached blocks from an older heap are dropped
+static int heapEpoch;
+static pthread_key_t tcacheKey;
+static pthread_once_t tcacheOnce = PTHREAD_ONCE_INIT;
+
+// arena the calling thread allocates from; -1 until it gets one
+static __thread int homeArena = -1;
+// the next thread without an arena gets this one, round robin
+static int nextArena;
+// set once the arena locks have been created
+static int arenaLocks;
+
+// LOCK_HOME locks the calling thread's arena and evaluates to 0, or
+// to -1 if a new arena couldn't be set up.  LOCK_ARENA locks arena a,
+// which must already be set up.  Both make it the arena that ar points to.
+#define LOCK_HOME() lockHomeArena()
+#define LOCK_ARENA(a) (pthread_mutex_lock(&arenas[a].lock), ar = &arenas[a])
+#define UNLOCK_ARENA() pthread_mutex_unlock(&ar->lock)
+#else
+#define LOCK_HOME() 0
+#define LOCK_ARENA(a)
+#define UNLOCK_ARENA()
+#endif
 
 // Helper Functions
+static int arenaInit(void);
+static int arenaCheck(void);
+static void printArenaBlocks(void);
+static void printArenaFreeList(void);
+static void *allocBlock(size_t asize);
+static void freeBlock(void *ptr);
+static void *freeToList(void *ptr);
+static void trim(void *bp, void *freed, size_t fsize);
+static void *mapBlock(size_t asize);
+static void unmapBlock(void *bp);
+static void *remapBlock(void *bp, size_t asize);
+static void consolidate(void);
+static void *find_fit(size_t asize);
+static int mayFit(size_t asize);
+static void *alignedBlock(size_t asize, size_t align);
+static int slabClass(size_t size);
+static int isSlab(int a, void *p);
+static void markSlabPage(struct slab *sl, int isSlab);
+static void slabLink(struct slab *sl);
+static void slabUnlink(struct slab *sl);
+static struct slab *newSlab(int c);
+static void *slabMalloc(size_t size);
+static void slabFree(void *p);
+static void indexAdd(void *bp, size_t size);
+static void indexRemove(void *bp);
+static void indexReplace(void *bp, void *nbp, size_t size);
+static int indexFind(const unsigned int *a, int n, unsigned int key);
+static int indexFirstFit(const unsigned int *a, int n, unsigned int asize);
+static int indexBestFit(const unsigned int *a, int n, unsigned int asize);
 static void *extend_heap(size_t words);
+static void *growHeap(size_t asize);
 static void *coalesce(void *bp);
 static void *first_fit(size_t asize);
 static void *next_fit(size_t asize);
 static void *best_fit(size_t asize);
+static void *good_fit(size_t asize);
 static void place(void *bp, size_t asize);
+static size_t adjustSize(size_t size);
+static int resizeInPlace(void *bp, size_t asize);
 static void removeBlock(void *bp);
 static void insertInFront(void *bp);
+static void insertOrdered(void *bp, int c);
+static void addrSet(void *bp, int c);
+static void addrClear(void *bp, int c);
+static char *addrPrev(void *bp, int c);
+static void addrReset(void);
+static int sizeClass(size_t size);
+static void treeInsert(void *bp);
+static void treeRemove(void *bp);
+static void treeRebalance(char *bp);
+static void treeReplace(char *parent, char *old, char *new);
+static void treeFixHeight(char *bp);
+static char *treeRotateLeft(char *bp);
+static char *treeRotateRight(char *bp);
+static int treeCheck(char *bp, char *parent);
+#ifdef THREADSAFE
+static int lockHomeArena(void);
+static char *releaseBlocks(char *bp, int n);
+static void remoteFree(int a, char *bp);
+static void drainRemoteFrees(void);
+static struct tcache *getCache(void);
+static void *cacheMalloc(size_t asize);
+static void cacheFree(void *ptr);
+static void cacheFlush(void *arg);
+static void makeCacheKey(void);
+#endif
 
 /* which fitting technique to use */
 /* default is first fit */
 int whichfit = FIRSTFIT;
 
+/* good fit looks at no more than goodProbes free blocks and takes */
+/* the first one that is at most goodSlack percent too big */
+int goodProbes = 8;
+int goodSlack = 10;
+
+/* how free blocks are put in a list */
+/* default is at the front */
+int whichorder = LIFO;
+
+/* set to keep small freed blocks in fast bins */
+int useFastBins = 0;
+
+/* set to search the dense index instead of the free lists */
+int useIndex = 0;
+
+/* 2 if the CPU has AVX2, 1 for SSE2 and 0 for the plain C scans */
+static int simdLevel;
+
+/* set to serve requests of up to SLABMAX bytes from slabs */
+int useSlabs = 0;
+
+/* if not 0, an arena grows by this percent of its size when nothing */
+/* fits instead of by CHUNKSIZE */
+int growthPercent = 0;
+
+/* if not 0, free blocks of at least this many bytes are given back */
+/* to the OS */
+int trimThreshold = 0;
+
+/* if not 0, requests of at least this many bytes get a mapping of */
+/* their own instead of a block in the heap */
+int mmapThreshold = 0;
+
+/* bytes mm_realloc has copied from one block to another */
+size_t reallocCopied = 0;
+
+/* object size of each slab size class */
+static const unsigned int slabSize[NUMSLABS] = {8, 16, 24, 32, 48, 64};
+
 /*
- * mm_init - initialize the malloc package for implict list
- *           allocation. Specifically, initialize the heap
- *           to contain an allocated block with no payload (prologue),
- *           followed by a big free block, followed by an allocated
- *           block with no footer (epilogue). The prologue and epilogue
- *           blocks make the coalescing logic simpler.
+ * mm_init - initialize the malloc package for explicit list
+ *           allocation.  Arena 0 is set up right away; in the thread
+ *           safe build the other arenas are set up when a thread is
+ *           first given one.
  */
 int mm_init(void)
 {
-   if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
+   int i;
+
+#ifndef FIT
+   // the policy has to be picked before mm_init is called since it
+   // decides which list each free block lives in
+   useTree = (whichfit == BESTFIT);
+   numClasses = (whichfit == SEGFIT || whichfit == GOODFIT || useTree) ?
+                NUMCLASSES : 1;
+#endif
+   // the dense index, the address map and the slab page bitmap only
+   // cover MAX_HEAP bytes of each arena
+   if ((useIndex || useSlabs || WHICHORDER == ADDRORDER) &&
+       mem_max_heapsize() > MAX_HEAP)
       return -1;
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_cpu_init();
+   simdLevel = __builtin_cpu_supports("avx2") ? 2 :
+               __builtin_cpu_supports("sse2") ? 1 : 0;
+#endif
 
-   PUT(heap_listp, 0);                            // Padding
-   PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); // Prologue header
-   PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); // Prologue footer
-   PUT(heap_listp + (3 * WSIZE), PACK(0, 1));     // Epilogue header
+#ifdef THREADSAFE
+   if (!arenaLocks)
+   {
+      for (i = 0; i < NUMARENAS; i++)
+         pthread_mutex_init(&arenas[i].lock, NULL);
+      arenaLocks = 1;
+   }
+   // every thread cache now holds blocks of the old heap
+   __atomic_add_fetch(&heapEpoch, 1, __ATOMIC_RELEASE);
+#endif
+   for (i = 0; i < NUMARENAS; i++)
+   {
+      arenas[i].heap_listp = NULL;
+#ifdef THREADSAFE
+      arenas[i].remoteFree = NULL;
+#endif
+   }
 
-   // Make heap_listp point to footer of Prologue block
-   // This is the payload of the first (and only) allocated block
-   heap_listp += (2 * WSIZE);
-   firstFree = lastFree = 0;
+   ar = &arenas[0];
+   return arenaInit();
+}
+
+/*
+ * arenaInit - Sets up the heap of arena ar.  Specifically, initialize
+ *             the heap to contain an allocated block with no payload
+ *             (prologue), followed by a big free block, followed by an
+ *             allocated block with no footer (epilogue). The prologue
+ *             and epilogue blocks make the coalescing logic simpler.
+ */
+static int arenaInit(void)
+{
+   int i;
+   char *start;
+
+   if ((start = mem_arena_sbrk(ar - arenas, 4 * WSIZE)) == (void *)-1)
+      return -1;
+   ar->heap_base = start;
+
+   PUT(start, 0);                                         // Padding
+   PUT(start + (1 * WSIZE), PACK(DSIZE, PREV_ALLOC | 1)); // Prologue header
+   PUT(start + (2 * WSIZE), PACK(DSIZE, 1));              // Prologue footer
+   PUT(start + (3 * WSIZE), PACK(0, PREV_ALLOC | 1));     // Epilogue header
+
+   for (i = 0; i < NUMCLASSES; i++)
+   {
+      ar->firstFree[i] = ar->lastFree[i] = 0;
+      ar->maxFree[i] = 0;
+   }
+   ar->treeRoot = 0;
+   for (i = 0; i < NUMFAST; i++)
+      ar->fastBin[i] = 0;
+   ar->fastCount = 0;
+   for (i = 0; i < NUMSLABS; i++)
+      ar->slabs[i] = NULL;
+   ar->spareSlabs = NULL;
+   memset(ar->slabPages, 0, sizeof(ar->slabPages));
+   if (useIndex && ar->idx == NULL)
+   {
+      void *idx = mmap(NULL, sizeof(struct denseIndex), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (idx == MAP_FAILED)
+         return -1;
+      ar->idx = idx;
+   }
+   ar->idxCount = 0;
+   if (WHICHORDER == ADDRORDER && ar->addr == NULL)
+   {
+      void *addr = mmap(NULL, sizeof(struct addrMap), PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (addr == MAP_FAILED)
+         return -1;
+      ar->addr = addr;
+   }
+   else if (WHICHORDER == ADDRORDER)
+   {
+      addrReset();
+   }
    char *bp;
    if ((bp = extend_heap(CHUNKSIZE / WSIZE)) == NULL)
       return -1;
 
+   // Make heap_listp point to footer of Prologue block
+   // This is the payload of the first (and only) allocated block
+   ar->heap_listp = start + (2 * WSIZE);
+
    // current is used for next fit placement
    // current always points to a free block or is NULL if
    // there are no free blocks
-   current = firstFree;
+   ar->current = ar->firstFree[0];
    return 0;
 }
 
 /*
- * mm_malloc - Finds a free block of size bytes using the
- *     placement policy indicated by whichfit.
- *     If no block can be found, extend the heap.
- *
+ * mm_malloc - Returns a block with room for size bytes.  The thread safe
+ *     build first looks in the cache of the calling thread.
  */
 void *mm_malloc(size_t size)
 {
    size_t asize;
-   size_t extendsize;
    char *bp;
 
    if (size == 0)
       return NULL;
 
-   // Adjust the size to make room for the header, footer,
-   // predecessor, and successor and adhere to the alignment restrictions.
-   if (size <= DSIZE)
+   if (useSlabs && size <= SLABMAX)
    {
-      // minimum block size is 2*DSIZE
-      asize = 2 * DSIZE;
+      if (LOCK_HOME() < 0)
+         return NULL;
+      bp = slabMalloc(size);
+      UNLOCK_ARENA();
+      return bp;
    }
-   else
+
+   // big requests get a mapping of their own if there is one to be had
+   asize = adjustSize(size);
+   if (mmapThreshold > 0 && asize >= (size_t)mmapThreshold &&
+       (bp = mapBlock(asize)) != NULL)
+      return bp;
+
+#ifdef THREADSAFE
+   return cacheMalloc(asize);
+#else
+   return allocBlock(asize);
+#endif
+}
+
+/*
+ * allocBlock - Finds a free block of asize bytes using the
+ *     placement policy indicated by whichfit.
+ *     If no block can be found, extend the heap.
+ *
+ */
+static void *allocBlock(size_t asize)
+{
+   char *bp;
+
+   // a block of exactly the right size may be waiting in a fast bin
+   if (FASTBINS && asize <= FASTMAX && ar->fastBin[FAST_BIN(asize)] != 0)
    {
-      // size must be a multiple of DSIZE
-      asize = DSIZE * ((size + (DSIZE) + (DSIZE - 1)) / DSIZE);
+      bp = ar->fastBin[FAST_BIN(asize)];
+      ar->fastBin[FAST_BIN(asize)] = GET_PTR(PRED(bp));
+      ar->fastCount--;
+      return bp;
    }
 
-   // Search free list for fit.
-
-   if (whichfit == BESTFIT)
-      bp = best_fit(asize);
-   else if (whichfit == NEXTFIT)
-      bp = next_fit(asize);
-   else
-      bp = first_fit(asize); // default
+   // Search free list for fit.  If nothing fits, move the blocks in
+   // the fast bins to the free lists and look again before growing
+   // the heap.
+   bp = find_fit(asize);
+   if (bp == NULL && ar->fastCount > 0)
+   {
+      consolidate();
+      bp = find_fit(asize);
+   }
 
    // If a free block was found then use it
    if (bp != NULL)
    {
-      current = (char *)GET(SUCC(bp)); // for next fit
+      ar->current = bp; // for next fit; place moves it off bp
       place(bp, asize);
       return bp;
    }
 
    // No free block found, extend the heap
-   extendsize = MAX(asize, CHUNKSIZE);
-   if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+   if ((bp = growHeap(asize)) == NULL)
    {
       return NULL;
    }
 
    // allocate the block
-   current = (char *)GET(SUCC(bp)); // for next fit
+   ar->current = bp; // for next fit; place moves it off bp
    place(bp, asize);
    return bp;
 }
 
 /*
- * mm_free - Free the block and coalesce it with adjacent free blocks.
- *           ptr points to the payload of the block to be free.
+ * mm_free - Frees the block ptr points to.  The thread safe build
+ *           keeps small blocks in the cache of the calling thread.
  */
 void mm_free(void *ptr)
+{
+   int a;
+
+   // a slab object has no header, so it has to be ruled out before the
+   // mapped bit is looked at.  A mapped block isn't in any arena.
+   if (useSlabs && (a = mem_arena_of(ptr)) >= 0 && isSlab(a, ptr))
+   {
+#ifdef THREADSAFE
+      // like any other block, an object of another thread's arena
+      // waits on its remote free stack instead of for its lock
+      if (a != homeArena)
+      {
+         remoteFree(a, ptr);
+         return;
+      }
+#endif
+      LOCK_ARENA(a);
+      slabFree(ptr);
+      UNLOCK_ARENA();
+      return;
+   }
+   if (GET_MAPPED(HDRP(ptr)))
+   {
+      unmapBlock(ptr);
+      return;
+   }
+
+#ifdef THREADSAFE
+   cacheFree(ptr);
+#else
+   freeBlock(ptr);
+#endif
+}
+
+/*
+ * freeBlock - Frees the block ptr points to.  Small blocks go into a
+ *             fast bin if useFastBins is set.
+ */
+static void freeBlock(void *ptr)
 {
    size_t size = GET_SIZE(HDRP(ptr));
    if (GET_ALLOC(HDRP(ptr)) == 0)
       return;
 
-   PUT(HDRP(ptr), PACK(size, 0));
+   if (FASTBINS && size <= FASTMAX)
+   {
+      PUT_PTR(PRED(ptr), ar->fastBin[FAST_BIN(size)]);
+      ar->fastBin[FAST_BIN(size)] = ptr;
+      ar->fastCount++;
+      return;
+   }
+   trim(freeToList(ptr), ptr, size);
+}
+
+/*
+ * freeToList - Free the block and coalesce it with adjacent free blocks.
+ *              ptr points to the payload of the block to be free.
+ *              Returns a pointer to the coalesced block.
+ */
+static void *freeToList(void *ptr)
+{
+   size_t size = GET_SIZE(HDRP(ptr));
+
+   PUT(HDRP(ptr), PACK(size, GET_PREV_ALLOC(HDRP(ptr))));
    PUT(FTRP(ptr), PACK(size, 0));
+   CLEAR_PREV_ALLOC(NEXT_BLKP(ptr));
    insertInFront(ptr);
-   coalesce(ptr);
+   return coalesce(ptr);
+}
+
+/*
+ * mapBlock - Gives a block for asize bytes its own mapping outside the
+ *            heap.  The payload starts DSIZE bytes into the mapping so
+ *            it is aligned, and the header holds the mapping size.
+ *            Returns NULL if there is no mapping to be had.
+ */
+static void *mapBlock(size_t asize)
+{
+   size_t msize = MAP_SIZE(asize);
+   char *bp;
+
+   if ((bp = mem_map(msize)) == NULL)
+      return NULL;
+   bp += DSIZE;
+   PUT(HDRP(bp), PACK(msize, MAPPED | 1));
+   return bp;
+}
+
+/*
+ * unmapBlock - Gives the mapping of block bp back right away.
+ */
+static void unmapBlock(void *bp)
+{
+   mem_unmap((char *)bp - DSIZE, GET_SIZE(HDRP(bp)));
+}
+
+/*
+ * remapBlock - Resizes the mapping of block bp to hold asize bytes with
+ *              mremap, which moves page table entries instead of
+ *              copying the payload.  Returns the block's new address,
+ *              which may be different, or NULL if the mapping can't be
+ *              resized.
+ */
+static void *remapBlock(void *bp, size_t asize)
+{
+   size_t msize = MAP_SIZE(asize);
+   char *lo;
+
+   if (msize == GET_SIZE(HDRP(bp)))
+      return bp;
+   if ((lo = mem_remap((char *)bp - DSIZE, GET_SIZE(HDRP(bp)), msize)) == NULL)
+      return NULL;
+   bp = lo + DSIZE;
+   PUT(HDRP(bp), PACK(msize, MAPPED | 1));
+   return bp;
+}
+
+/*
+ * trim - Gives the memory of the free block bp back to the OS if it
+ *        is at least trimThreshold bytes.  bp is what the block freed
+ *        of fsize bytes became after coalescing.  The last block in
+ *        the arena is cut down to CHUNKSIZE bytes so the next request
+ *        doesn't grow the arena right away.  Any other block keeps its
+ *        size but the whole pages between its links and its footer are
+ *        released.  A block bp was coalesced with that was already
+ *        trimThreshold bytes had its pages released when it was freed,
+ *        so only the pages of freed and the ones next to it are.
+ */
+static void trim(void *bp, void *freed, size_t fsize)
+{
+   size_t size = GET_SIZE(HDRP(bp));
+   size_t page;
+   char *lo = HEIGHT(bp) + WSIZE;
+   char *hi = FTRP(bp);
+
+   if (trimThreshold <= 0 || size < (size_t)trimThreshold)
+      return;
+
+   if (GET_SIZE(HDRP(NEXT_BLKP(bp))) != 0)
+   {
+      page = mem_pagesize();
+      // the list and tree links are in the first six words; the pages
+      // of a big neighbor stop short of its footer and its links
+      if ((size_t)((char *)freed - (char *)bp) >= (size_t)trimThreshold)
+         lo = MAX(lo, (char *)(((unsigned long)freed - DSIZE) & ~(page - 1)));
+      if ((size_t)(NEXT_BLKP(bp) - ((char *)freed + fsize)) >=
+          (size_t)trimThreshold)
+         hi = MIN(hi, (char *)(((unsigned long)freed + fsize + 6 * WSIZE +
+                                page - 1) & ~(page - 1)));
+      if (lo < hi)
+         mem_release(lo, hi - lo);
+      return;
+   }
+   if (size <= CHUNKSIZE ||
+       mem_arena_sbrk(ar - arenas, -(int)(size - CHUNKSIZE)) == (void *)-1)
+      return;
+
+   // the smaller block may belong in another list
+   removeBlock(bp);
+   PUT(HDRP(bp), PACK(CHUNKSIZE, GET_PREV_ALLOC(HDRP(bp))));
+   PUT(FTRP(bp), PACK(CHUNKSIZE, 0));
+   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+   insertInFront(bp);
 }
 
 /*
- * mm_realloc - Allocate a new block of size bytes.  Copy the contents
- *              of the block pointed to by ptr into that block.
+ * mm_realloc - Resize the block pointed to by ptr to size bytes.
+ *              The block is shrunk or grown in place when possible.
+ *              A block with a mapping of its own is resized with
+ *              mremap.
+ *              Otherwise allocate a new block of size bytes and copy
+ *              the contents of the block pointed to by ptr into it.
  *              Returns a pointer to the payload of the new block.
  */
 void *mm_realloc(void *ptr, size_t size)
@@ -268,11 +975,42 @@ void *mm_realloc(void *ptr, size_t size)
       mm_free(ptr);
       return NULL;
    }
-   // See if block is already big enough
-   // Need room for payload of size bytes plus header and footer
-   if (GET_SIZE(HDRP(ptr)) >= (size + WSIZE + WSIZE))
+   // a slab object can't grow, so it is moved unless it is big enough
+   if (useSlabs && mem_arena_of(ptr) >= 0 && isSlab(mem_arena_of(ptr), ptr))
+   {
+      unsigned int oldSize = SLAB_OF(ptr)->size;
+      void *newptr;
+
+      if (size <= oldSize)
+         return ptr;
+      if ((newptr = mm_malloc(size)) == NULL)
+         return NULL;
+      memcpy(newptr, ptr, oldSize);
+      __atomic_fetch_add(&reallocCopied, oldSize, __ATOMIC_RELAXED);
+      mm_free(ptr);
+      return newptr;
+   }
+   // a mapped block that is still big enough for a mapping of its
+   // own is resized by the kernel without copying
+   if (GET_MAPPED(HDRP(ptr)) && mmapThreshold > 0 &&
+       adjustSize(size) >= (size_t)mmapThreshold)
    {
-      return ptr;
+      void *newptr = remapBlock(ptr, adjustSize(size));
+      if (newptr != NULL)
+         return newptr;
+   }
+   // Shrink the block, or grow it into the free block after it or
+   // into new heap space if it is the last block in the heap.  A
+   // mapped block that wasn't resized above is moved.
+   if (!GET_MAPPED(HDRP(ptr)))
+   {
+      LOCK_ARENA(mem_arena_of(ptr));
+      int resized = resizeInPlace(ptr, adjustSize(size));
+      UNLOCK_ARENA();
+      if (resized)
+      {
+         return ptr;
+      }
    }
 
    void *oldptr = ptr;
@@ -282,7 +1020,10 @@ void *mm_realloc(void *ptr, size_t size)
    if (newptr == NULL)
       return NULL;
 
-   size_t copySize = GET_SIZE(HDRP(oldptr));
+   // the payload is everything after the header, which is DSIZE
+   // bytes into a mapping
+   size_t copySize = GET_SIZE(HDRP(oldptr)) -
+                     (GET_MAPPED(HDRP(oldptr)) ? DSIZE : WSIZE);
 
    // if the original block is bigger than size parameter,
    // only copy what will fit into the new block
@@ -292,194 +1033,1579 @@ void *mm_realloc(void *ptr, size_t size)
    // Copy the contents of the old block into
    // the new block
    memcpy(newptr, oldptr, copySize);
+   __atomic_fetch_add(&reallocCopied, copySize, __ATOMIC_RELAXED);
    // Free the old block
    mm_free(oldptr);
 
    return newptr;
 }
 
+#ifdef THREADSAFE
 /*
- * insertFront - Takes a pointer to a free block and inserts the
- *               block so that it is the first block in the
- *               explicit list.
- *               The global firstFree and possibly lastFree are
- *               modified by the function.
+ * lockHomeArena - Locks the arena of the calling thread and makes ar
+ *                 point to it.  A thread is given an arena round robin
+ *                 the first time it calls this.  If its arena is locked
+ *                 by another thread, it moves to the first arena that
+ *                 isn't, and only waits if all of them are busy.
+ *                 Returns -1 if a new arena couldn't be set up.
  */
-static void insertInFront(void *bp)
+static int lockHomeArena(void)
 {
-   // Indicate that BP is the head of the list.
-   // Set bp->successor to the current first block.
-   //
-   PUT(PRED(bp), (unsigned int)0);
-   PUT(SUCC(bp), (unsigned int)firstFree);
+   int i, a;
+
+   if (homeArena < 0)
+      homeArena = __atomic_fetch_add(&nextArena, 1, __ATOMIC_RELAXED) % NUMARENAS;
 
-   // Change PRED of old first block to bp
-   if (firstFree != 0)
+   for (i = 0; i < NUMARENAS; i++)
    {
-      PUT(PRED(firstFree), (unsigned int)bp);
+      a = (homeArena + i) % NUMARENAS;
+      if (pthread_mutex_trylock(&arenas[a].lock) == 0)
+         break;
    }
+   if (i == NUMARENAS)
+   {
+      a = homeArena;
+      pthread_mutex_lock(&arenas[a].lock);
+   }
+   homeArena = a;
+   ar = &arenas[a];
 
-   // Since there is now a free block at the front,
-   firstFree = bp;
-
-   if (lastFree == 0)
+   if (ar->heap_listp == NULL && arenaInit() < 0)
    {
-      lastFree = firstFree;
+      UNLOCK_ARENA();
+      return -1;
    }
+   drainRemoteFrees();
+   return 0;
 }
 
 /*
- * extend_heap - extends the size of the heap by words * WSIZE bytes
- *
+ * releaseBlocks - Frees the first n blocks of a chain of cached blocks
+ *                 starting at bp, each to the arena it came from.  An
+ *                 arena stays locked while consecutive blocks belong to
+ *                 it.  Blocks of other threads' arenas go on their
+ *                 remote free stacks.  Returns the rest of the chain.
  */
-static void *extend_heap(size_t words)
+static char *releaseBlocks(char *bp, int n)
 {
-   char *bp;
-   size_t size;
+   int held = -1;
+   int a;
+   char *next;
 
-   size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
+   for (; bp != NULL && n > 0; bp = next, n--)
+   {
+      next = CACHE_NEXT(bp);
+      a = mem_arena_of(bp);
+      if (a != homeArena)
+      {
+         remoteFree(a, bp);
+         continue;
+      }
+      if (a != held)
+      {
+         if (held >= 0)
+            UNLOCK_ARENA();
+         LOCK_ARENA(a);
+         held = a;
+      }
+      freeBlock(bp);
+   }
+   if (held >= 0)
+      UNLOCK_ARENA();
+   return bp;
+}
 
-   if (((long)(bp = mem_sbrk(size)) == -1))
-      return NULL;
+/*
+ * remoteFree - Pushes the allocated block or slab object bp onto the
+ *              remote free stack of arena a without taking its lock.  It
+ *              is freed the next time a thread allocates from that arena.
+ */
+static void remoteFree(int a, char *bp)
+{
+   char *head = __atomic_load_n(&arenas[a].remoteFree, __ATOMIC_RELAXED);
 
-   PUT(HDRP(bp), PACK(size, 0));
-   PUT(FTRP(bp), PACK(size, 0));
-   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+   do
+      CACHE_NEXT(bp) = head;
+   while (!__atomic_compare_exchange_n(&arenas[a].remoteFree, &head, bp, 1,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
 
-   // put this new block in the front of the free list
-   insertInFront(bp);
+/*
+ * drainRemoteFrees - Frees every block and slab object on the remote
+ *                    free stack of arena ar, which the caller has locked.
+ *                    The whole stack is taken with one exchange, so
+ *                    threads can keep pushing while it is drained.
+ */
+static void drainRemoteFrees(void)
+{
+   char *bp = __atomic_exchange_n(&ar->remoteFree, NULL, __ATOMIC_ACQUIRE);
+   char *next;
 
-   // may be able to coalesce with the block in
-   // memory above it
-   return coalesce(bp);
+   for (; bp != NULL; bp = next)
+   {
+      next = CACHE_NEXT(bp);
+      if (useSlabs && isSlab(ar - arenas, bp))
+         slabFree(bp);
+      else
+         freeBlock(bp);
+   }
 }
 
 /*
- * coalesce - coalesces two or more blocks.
- *            bp points to the payload of the free block.
- *            Tries to coalesce that block with the one before
- *            it and the one after it.
- *            Returns a pointer to the possibly bigger free block.
+ * getCache - Returns the cache of the calling thread.  The cache is
+ *            emptied if mm_init has reset the heap since it was filled,
+ *            and is set up to be flushed when the thread exits.
  */
-static void *coalesce(void *bp)
+static struct tcache *getCache(void)
 {
-   // TODO
-   // Use the slides to help you figure out how to implement this.
-   // Also take a look at the implicit list code.
-   // removeBlock function is very helpful here.
-   // Macros defined at the top of the file are also very helpful.
-   size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
-   size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
-   size_t size = GET_SIZE(HDRP(bp));
+   struct tcache *tc = &tcache;
+   int epoch = __atomic_load_n(&heapEpoch, __ATOMIC_ACQUIRE);
 
-   // NOTE: In the slides it states the following:
-   // Some extra space for the links (2 extra words
-   // needed for each block)
-   //
-   // This may be important?? - Justin
+   if (tc->epoch != epoch)
+   {
+      memset(tc->head, 0, sizeof(tc->head));
+      memset(tc->count, 0, sizeof(tc->count));
+      tc->epoch = epoch;
+   }
+   if (!tc->registered)
+   {
+      pthread_once(&tcacheOnce, makeCacheKey);
+      pthread_setspecific(tcacheKey, tc);
+      tc->registered = 1;
+   }
+   return tc;
+}
 
-   // From Norris' email:
-   // In the cases where the previous block is free, you need to remove
-   // it from the free list because the coalesced block that ends up on
-   // the list needs to begin with that block.
+/*
+ * cacheMalloc - Returns a block of asize bytes.  Small blocks come from
+ *               the cache of the calling thread.  If that cache is empty
+ *               TCACHE_BATCH blocks are taken from the thread's arena
+ *               under one lock; one is returned and the rest are cached.
+ */
+static void *cacheMalloc(size_t asize)
+{
+   struct tcache *tc;
+   char *bp, *extra;
+   int bin, i;
 
-   // case 1: Insert the freed block at the root of the list.
-   if (prev_alloc && next_alloc)
+   if (asize > TCACHE_MAXSIZE)
    {
+      if (LOCK_HOME() < 0)
+         return NULL;
+      bp = allocBlock(asize);
+      UNLOCK_ARENA();
       return bp;
    }
-   // case 2: Splice out the succ block, coalesce both memory
-   // blocks and insert the new block at the root of the list.
+
+   tc = getCache();
+   bin = TCACHE_BIN(asize);
+   if ((bp = tc->head[bin]) != NULL)
+   {
+      tc->head[bin] = CACHE_NEXT(bp);
+      tc->count[bin]--;
+      return bp;
+   }
+
+   if (LOCK_HOME() < 0)
+      return NULL;
+   bp = allocBlock(asize);
+   for (i = 1; bp != NULL && i < TCACHE_BATCH; i++)
+   {
+      if ((extra = allocBlock(asize)) == NULL)
+         break;
+      CACHE_NEXT(extra) = tc->head[bin];
+      tc->head[bin] = extra;
+      tc->count[bin]++;
+   }
+   UNLOCK_ARENA();
+   return bp;
+}
+
+/*
+ * cacheFree - Puts a small block in the cache of the calling thread.
+ *             When the cache for that size is full, TCACHE_BATCH blocks
+ *             are given back to their arenas.  Big blocks are freed
+ *             right away.
+ */
+static void cacheFree(void *ptr)
+{
+   struct tcache *tc;
+   int bin;
+
+   // Another thread may be changing the prev-alloc bit of this header
+   // while holding the lock, but the size bits of an allocated block
+   // only change when its owner frees or reallocates it.
+   size_t size = __atomic_load_n((unsigned int *)HDRP(ptr), __ATOMIC_RELAXED) & ~0x7;
+
+   if (size > TCACHE_MAXSIZE)
+   {
+      releaseBlocks(ptr, 1);
+      return;
+   }
+
+   tc = getCache();
+   bin = TCACHE_BIN(size);
+   CACHE_NEXT(ptr) = tc->head[bin];
+   tc->head[bin] = ptr;
+   if (++tc->count[bin] <= TCACHE_MAX)
+      return;
+
+   tc->head[bin] = releaseBlocks(tc->head[bin], TCACHE_BATCH);
+   tc->count[bin] -= TCACHE_BATCH;
+}
+
+/*
+ * cacheFlush - Gives every block in a thread's cache back to the heap.
+ *              Called when the thread exits.
+ */
+static void cacheFlush(void *arg)
+{
+   struct tcache *tc = arg;
+   int bin;
+
+   // blocks cached before the last mm_init are not in the heap anymore
+   if (tc->epoch != __atomic_load_n(&heapEpoch, __ATOMIC_ACQUIRE))
+      return;
+   for (bin = 0; bin < TCACHE_BINS; bin++)
+   {
+      releaseBlocks(tc->head[bin], tc->count[bin]);
+      tc->head[bin] = NULL;
+      tc->count[bin] = 0;
+   }
+}
+
+/*
+ * makeCacheKey - Creates the key whose destructor flushes the cache
+ *                of an exiting thread.
+ */
+static void makeCacheKey(void)
+{
+   pthread_key_create(&tcacheKey, cacheFlush);
+}
+#endif
+
+/*
+ * consolidate - Moves every block in the fast bins to the free lists,
+ *               coalescing it with its neighbors.  Blocks next to a
+ *               block that is still in a fast bin look allocated, but
+ *               they are joined when that block is freed later in the
+ *               pass.  Like mm_free, it gives back the memory of the
+ *               blocks that coalescing makes big enough.
+ */
+static void consolidate(void)
+{
+   char *bp;
+   int i;
+
+   for (i = 0; i < NUMFAST; i++)
+   {
+      while ((bp = ar->fastBin[i]) != 0)
+      {
+         size_t size = GET_SIZE(HDRP(bp));
+         ar->fastBin[i] = GET_PTR(PRED(bp));
+         // coalescing can make a block big enough to give back
+         trim(freeToList(bp), bp, size);
+      }
+   }
+   ar->fastCount = 0;
+}
+
+/*
+ * find_fit - Searches the free lists for a block of asize bytes with
+ *            the placement policy indicated by whichfit.  With
+ *            segregated fit first_fit only looks at the lists that can
+ *            hold a block of asize bytes.
+ *            Returns a pointer to the found block or NULL if no
+ *            block fits.
+ */
+static void *find_fit(size_t asize)
+{
+   // don't search if no list can have a block that is big enough
+   if (!mayFit(asize))
+      return NULL;
+
+   if (WHICHFIT == BESTFIT)
+      return best_fit(asize);
+   else if (WHICHFIT == GOODFIT)
+      return good_fit(asize);
+   else if (WHICHFIT == NEXTFIT)
+      return next_fit(asize);
+   else
+      return first_fit(asize); // default
+}
+
+/*
+ * mayFit - Returns 0 if maxFree shows that no free list has a block of
+ *          asize bytes, and 1 if one of them might.
+ */
+static int mayFit(size_t asize)
+{
+   int c;
+
+   for (c = sizeClass(asize); c < numClasses; c++)
+   {
+      if (ar->maxFree[c] >= asize)
+         return 1;
+   }
+   return 0;
+}
+
+/*
+ * alignedBlock - Returns an allocated block of asize bytes whose payload
+ *                starts on a multiple of align, which is a power of two.
+ *                A bigger block is allocated and the parts before and
+ *                after the aligned block are freed again.
+ */
+static void *alignedBlock(size_t asize, size_t align)
+{
+   char *bp, *abp;
+   size_t size, lead;
+
+   if ((bp = allocBlock(asize + align + MINBLOCK)) == NULL)
+      return NULL;
+
+   // the part in front must be empty or big enough to be a free block
+   abp = bp;
+   if ((unsigned long)bp & (align - 1))
+      abp = (char *)(((unsigned long)bp + MINBLOCK + align - 1) & ~(unsigned long)(align - 1));
+
+   lead = abp - bp;
+   if (lead > 0)
+   {
+      size = GET_SIZE(HDRP(bp));
+      PUT(HDRP(abp), PACK(size - lead, 1));
+      PUT(HDRP(bp), PACK(lead, GET_PREV_ALLOC(HDRP(bp))));
+      PUT(FTRP(bp), PACK(lead, 0));
+      insertInFront(bp);
+      coalesce(bp);
+   }
+   // give back the part after it
+   resizeInPlace(abp, asize);
+   return abp;
+}
+
+/*
+ * slabClass - Returns the slab size class for objects of size bytes.
+ */
+static int slabClass(size_t size)
+{
+   if (size <= 4 * DSIZE)
+      return (size + DSIZE - 1) / DSIZE - 1;
+   return size <= 6 * DSIZE ? 4 : 5;
+}
+
+/*
+ * isSlab - Returns 1 if p is in a page of arena a that is a slab.
+ *          The bit of a page only changes when the slab is made or
+ *          given back, so it can be read without the arena's lock
+ *          while p is in use.
+ */
+static int isSlab(int a, void *p)
+{
+   char *pageBase = (char *)SLAB_OF(arenas[a].heap_base);
+   unsigned long page = ((char *)p - pageBase) / PAGESIZE;
+
+   return (__atomic_load_n(&arenas[a].slabPages[page / 64], __ATOMIC_RELAXED) >> (page % 64)) & 1;
+}
+
+/*
+ * markSlabPage - Sets or clears the slab bit of the page of slab sl.
+ */
+static void markSlabPage(struct slab *sl, int isSlab)
+{
+   char *pageBase = (char *)SLAB_OF(ar->heap_base);
+   unsigned long page = ((char *)sl - pageBase) / PAGESIZE;
+
+   if (isSlab)
+      __atomic_or_fetch(&ar->slabPages[page / 64], 1ULL << (page % 64), __ATOMIC_RELAXED);
+   else
+      __atomic_and_fetch(&ar->slabPages[page / 64], ~(1ULL << (page % 64)), __ATOMIC_RELAXED);
+}
+
+/*
+ * slabLink - Puts slab sl at the front of the list for its size.
+ */
+static void slabLink(struct slab *sl)
+{
+   int c = slabClass(sl->size);
+
+   sl->prev = NULL;
+   sl->next = ar->slabs[c];
+   if (sl->next != NULL)
+      sl->next->prev = sl;
+   ar->slabs[c] = sl;
+}
+
+/*
+ * slabUnlink - Takes slab sl out of the list for its size.
+ */
+static void slabUnlink(struct slab *sl)
+{
+   if (sl->prev != NULL)
+      sl->prev->next = sl->next;
+   else
+      ar->slabs[slabClass(sl->size)] = sl->next;
+   if (sl->next != NULL)
+      sl->next->prev = sl->prev;
+}
+
+/*
+ * newSlab - Makes a slab for objects of class c and puts it in the list
+ *           for that class.  If there is no spare page, a chunk of
+ *           SLAB_CHUNK pages is carved out of the heap and split into
+ *           one block per page.
+ *           Returns NULL if the heap can't grow.
+ */
+static struct slab *newSlab(int c)
+{
+   struct slab *sl;
+   char *bp;
+   unsigned int n, w;
+
+   if (ar->spareSlabs == NULL)
+   {
+      if ((bp = alignedBlock(SLAB_CHUNK * PAGESIZE, PAGESIZE)) == NULL)
+         return NULL;
+      // the last page keeps whatever alignedBlock couldn't split off
+      n = GET_SIZE(HDRP(bp));
+      PUT(HDRP(bp), PACK(PAGESIZE, GET_PREV_ALLOC(HDRP(bp)) | 1));
+      for (w = 1; w < SLAB_CHUNK; w++)
+      {
+         PUT(HDRP(bp + w * PAGESIZE),
+             PACK(w < SLAB_CHUNK - 1 ? PAGESIZE : n - w * PAGESIZE, PREV_ALLOC | 1));
+         *(char **)(bp + w * PAGESIZE) = ar->spareSlabs;
+         ar->spareSlabs = bp + w * PAGESIZE;
+      }
+      sl = (struct slab *)bp;
+   }
+   else
+   {
+      sl = (struct slab *)ar->spareSlabs;
+      ar->spareSlabs = *(char **)sl;
+   }
+
+   sl->size = slabSize[c];
+   sl->nfree = n = SLAB_OBJECTS(sl->size);
+   for (w = 0; w < SLAB_WORDS; w++)
+   {
+      if (n >= 64)
+         sl->freeMap[w] = ~0ULL;
+      else
+         sl->freeMap[w] = (1ULL << n) - 1;
+      n -= (n >= 64) ? 64 : n;
+   }
+   markSlabPage(sl, 1);
+   slabLink(sl);
+   return sl;
+}
+
+/*
+ * slabMalloc - Returns a free object of at least size bytes from a
+ *              slab.  The first free object is found with ctz.
+ */
+static void *slabMalloc(size_t size)
+{
+   int c = slabClass(size);
+   struct slab *sl = ar->slabs[c];
+   int w, bit;
+
+   if (sl == NULL && (sl = newSlab(c)) == NULL)
+      return NULL;
+
+   for (w = 0; sl->freeMap[w] == 0; w++)
+      ;
+   bit = __builtin_ctzll(sl->freeMap[w]);
+   sl->freeMap[w] &= ~(1ULL << bit);
+   if (--sl->nfree == 0)
+      slabUnlink(sl);
+   return (char *)sl + SLAB_FIRST + (w * 64 + bit) * sl->size;
+}
+
+/*
+ * slabFree - Marks the object p free in its slab.  A slab whose objects
+ *            are all free is given back to the heap, unless it is the
+ *            only slab of its size.
+ */
+static void slabFree(void *p)
+{
+   struct slab *sl = SLAB_OF(p);
+   unsigned int i = ((char *)p - (char *)sl - SLAB_FIRST) / sl->size;
+
+   sl->freeMap[i / 64] |= 1ULL << (i % 64);
+   if (sl->nfree++ == 0)
+      slabLink(sl);
+   else if (sl->nfree == SLAB_OBJECTS(sl->size) &&
+            (sl->prev != NULL || sl->next != NULL))
+   {
+      slabUnlink(sl);
+      markSlabPage(sl, 0);
+      freeBlock(sl);
+   }
+}
+
+/*
+ * sizeClass - Returns the index of the free list that holds blocks
+ *             of size bytes.  Always 0 unless segregated fit is used.
+ */
+static int sizeClass(size_t size)
+{
+   int c;
+   size_t limit;
+
+   if (numClasses == 1)
+      return 0;
+
+   // 16, 24 and 32 byte blocks each get their own list
+   if (size <= 4 * DSIZE)
+      return (size / DSIZE) - 2;
+
+   // after that each list covers a power of two range
+   c = 3;
+   limit = 8 * DSIZE;
+   while (size > limit && c < numClasses - 1)
+   {
+      limit <<= 1;
+      c++;
+   }
+   return c;
+}
+
+/*
+ * insertFront - Takes a pointer to a free block and inserts the
+ *               block so that it is the first block in the
+ *               explicit list for its size class.
+ *               firstFree and possibly lastFree of that class are
+ *               modified by the function.
+ */
+static void insertInFront(void *bp)
+{
+   size_t size = GET_SIZE(HDRP(bp));
+   int c = sizeClass(size);
+
+   if (size > ar->maxFree[c])
+      ar->maxFree[c] = size;
+   if (useIndex)
+      indexAdd(bp, size);
+
+   if (WHICHORDER == ADDRORDER)
+   {
+      insertOrdered(bp, c);
+   }
+   else
+   {
+      // Indicate that BP is the head of the list.
+      // Set bp->successor to the current first block.
+      //
+      PUT_PTR(PRED(bp), 0);
+      PUT_PTR(SUCC(bp), ar->firstFree[c]);
+
+      // Change PRED of old first block to bp
+      if (ar->firstFree[c] != 0)
+      {
+         PUT_PTR(PRED(ar->firstFree[c]), bp);
+      }
+
+      // Since there is now a free block at the front,
+      ar->firstFree[c] = bp;
+
+      if (ar->lastFree[c] == 0)
+      {
+         ar->lastFree[c] = ar->firstFree[c];
+      }
+   }
+
+   if (useTree && size >= TREEMIN)
+      treeInsert(bp);
+}
+
+/*
+ * insertOrdered - Puts the free block bp in list c between the blocks
+ *                 before and after it in memory.  The block before it
+ *                 comes from the address map.
+ */
+static void insertOrdered(void *bp, int c)
+{
+   char *pred = addrPrev(bp, c);
+   char *succ = (pred != 0) ? GET_PTR(SUCC(pred)) : ar->firstFree[c];
+
+   addrSet(bp, c);
+   PUT_PTR(PRED(bp), pred);
+   PUT_PTR(SUCC(bp), succ);
+   if (pred != 0)
+      PUT_PTR(SUCC(pred), bp);
+   else
+      ar->firstFree[c] = bp;
+   if (succ != 0)
+      PUT_PTR(PRED(succ), bp);
+   else
+      ar->lastFree[c] = bp;
+}
+
+/*
+ * addrSet - Sets the bit of block bp in the address map of list c and
+ *           the summary bits above it.
+ */
+static void addrSet(void *bp, int c)
+{
+   struct addrMap *m = ar->addr;
+   size_t g = ((char *)bp - ar->heap_base) / DSIZE;
+
+   m->bits[c][g / 64] |= 1ULL << (g % 64);
+   m->summary[c][g / 64 / 64] |= 1ULL << (g / 64 % 64);
+   m->top[c][g / 64 / 64 / 64] |= 1ULL << (g / 64 / 64 % 64);
+}
+
+/*
+ * addrClear - Clears the bit of block bp in the address map of list c,
+ *             and the summary bits above it that now cover nothing.
+ */
+static void addrClear(void *bp, int c)
+{
+   struct addrMap *m = ar->addr;
+   size_t g = ((char *)bp - ar->heap_base) / DSIZE;
+   size_t w = g / 64, s = w / 64;
+
+   if ((m->bits[c][w] &= ~(1ULL << (g % 64))) != 0)
+      return;
+   if ((m->summary[c][s] &= ~(1ULL << (w % 64))) != 0)
+      return;
+   m->top[c][s / 64] &= ~(1ULL << (s % 64));
+}
+
+/*
+ * addrReset - Clears the address map of the old heap.  Only the words
+ *             the summary bits point at are cleared, so the rest of the
+ *             map is never touched.
+ */
+static void addrReset(void)
+{
+   struct addrMap *m = ar->addr;
+   size_t c, t, s;
+
+   for (c = 0; c < NUMCLASSES; c++)
+   {
+      for (t = 0; t < ADDR_TOP; t++)
+      {
+         while (m->top[c][t] != 0)
+         {
+            s = t * 64 + HIGH_BIT(m->top[c][t]);
+            while (m->summary[c][s] != 0)
+            {
+               m->bits[c][s * 64 + HIGH_BIT(m->summary[c][s])] = 0;
+               m->summary[c][s] &= BELOW(HIGH_BIT(m->summary[c][s]));
+            }
+            m->top[c][t] &= BELOW(HIGH_BIT(m->top[c][t]));
+         }
+      }
+   }
+}
+
+/*
+ * addrPrev - Returns the last block of list c before bp in memory, or
+ *            NULL if there isn't one.  Goes up the address map only as
+ *            far as it has to; only the top level is scanned, and it is
+ *            a few words.
+ */
+static char *addrPrev(void *bp, int c)
+{
+   struct addrMap *m = ar->addr;
+   size_t g = ((char *)bp - ar->heap_base) / DSIZE;
+   size_t w = g / 64, s = w / 64, t = s / 64;
+   unsigned long long bits;
+
+   if ((bits = m->bits[c][w] & BELOW(g % 64)) == 0)
+   {
+      if ((bits = m->summary[c][s] & BELOW(w % 64)) == 0)
+      {
+         bits = m->top[c][t] & BELOW(s % 64);
+         while (bits == 0 && t > 0)
+            bits = m->top[c][--t];
+         if (bits == 0)
+            return NULL;
+         s = t * 64 + HIGH_BIT(bits);
+         bits = m->summary[c][s];
+      }
+      w = s * 64 + HIGH_BIT(bits);
+      bits = m->bits[c][w];
+   }
+   return ar->heap_base + (w * 64 + HIGH_BIT(bits)) * DSIZE;
+}
+
+/*
+ * adjustSize - Returns the size of the block needed for a payload of
+ *              size bytes.  Adds room for the header and footer and
+ *              rounds up to a multiple of DSIZE.  The block must also
+ *              have room for the free list links once it is freed.
+ */
+static size_t adjustSize(size_t size)
+{
+   // minimum block size is 2*DSIZE, which leaves room for the
+   // footer and links once the block is freed
+   if (size <= DSIZE + WSIZE)
+      return 2 * DSIZE;
+
+   // size must be a multiple of DSIZE
+   return DSIZE * ((size + (WSIZE) + (DSIZE - 1)) / DSIZE);
+}
+
+/*
+ * resizeInPlace - Tries to make the allocated block bp asize bytes
+ *                 without moving it.
+ *                 A smaller block gives its tail back as a free block.
+ *                 A bigger block takes what it needs from the free
+ *                 block after it.  If bp is the last block in the heap
+ *                 (possibly followed by one free block) the heap is
+ *                 extended by the missing bytes.
+ *                 Returns 1 if bp now has room for asize bytes and 0
+ *                 if the block has to be moved.
+ */
+static int resizeInPlace(void *bp, size_t asize)
+{
+   size_t csize = GET_SIZE(HDRP(bp));
+   char *next = NEXT_BLKP(bp);
+   size_t avail = csize;
+
+   if (!GET_ALLOC(HDRP(next)))
+   {
+      avail += GET_SIZE(HDRP(next));
+      next = NEXT_BLKP(next);
+   }
+
+   // grow the heap if nothing but the epilogue follows; the new
+   // space is coalesced with the free block after bp, if any
+   if (avail < asize && GET_SIZE(HDRP(next)) == 0)
+   {
+      // the new space is a free block until it is merged, so it needs
+      // room for the links even if fewer bytes are missing
+      size_t grow = MAX(asize - avail, MINBLOCK);
+      if (extend_heap(grow / WSIZE) == NULL)
+         return 0;
+      avail += grow;
+   }
+   if (avail < asize)
+      return 0;
+
+   next = NEXT_BLKP(bp);
+   if (avail > csize)
+      removeBlock(next);
+
+   if ((avail - asize) >= SPLITMIN)
+   {
+      // split off the unused tail as a new free block
+      PUT(HDRP(bp), PACK(asize, GET_PREV_ALLOC(HDRP(bp)) | 1));
+      next = NEXT_BLKP(bp);
+      PUT(HDRP(next), PACK(avail - asize, PREV_ALLOC));
+      PUT(FTRP(next), PACK(avail - asize, 0));
+      CLEAR_PREV_ALLOC(NEXT_BLKP(next));
+      insertInFront(next);
+      // the bytes bp gave up are freed like any other block
+      if (csize > asize)
+         trim(next, next, csize - asize);
+   }
+   else
+   {
+      PUT(HDRP(bp), PACK(avail, GET_PREV_ALLOC(HDRP(bp)) | 1));
+      SET_PREV_ALLOC(NEXT_BLKP(bp));
+   }
+   return 1;
+}
+
+/*
+ * extend_heap - extends the size of the heap by words * WSIZE bytes
+ *
+ */
+static void *extend_heap(size_t words)
+{
+   char *bp;
+   size_t size;
+
+   size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
+
+   if (((long)(bp = mem_arena_sbrk(ar - arenas, size)) == -1))
+      return NULL;
+
+   // the old epilogue header becomes the new block's header and
+   // knows whether the block before it is allocated
+   PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+   PUT(FTRP(bp), PACK(size, 0));
+   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+
+   // put this new block in the front of the free list
+   insertInFront(bp);
+
+   // may be able to coalesce with the block in
+   // memory above it
+   return coalesce(bp);
+}
+
+/*
+ * growHeap - Returns a free block of at least asize bytes at the end of
+ *            the arena, extending the arena if it has to.
+ *            If the last block is free it is only grown by the bytes
+ *            it is missing.  Otherwise a new chunk is added.
+ */
+static void *growHeap(size_t asize)
+{
+   char *epilogue = (char *)mem_arena_hi(ar - arenas) + 1;
+   size_t heapsize = epilogue - ar->heap_base;
+   size_t tail = 0, chunk = CHUNKSIZE;
+
+   // the epilogue knows whether the last block is free, and then
+   // the footer of that block is right before the epilogue header
+   if (!GET_PREV_ALLOC(HDRP(epilogue)))
+      tail = GET_SIZE(HDRP(epilogue) - WSIZE);
+   if (tail >= asize)
+      return PREV_BLKP(epilogue);
+   // the new space is a free block until it is merged, so it needs
+   // room for the links even if fewer bytes are missing
+   if (tail > 0)
+      return extend_heap(MAX(asize - tail, MINBLOCK) / WSIZE);
+
+   if (growthPercent > 0)
+   {
+      chunk = MAX(CHUNKSIZE, MIN(heapsize / 100 * growthPercent, CHUNKMAX));
+      // don't ask for more than is left
+      chunk = MIN(chunk, mem_max_heapsize() - heapsize) & ~(DSIZE - 1);
+   }
+   return extend_heap(MAX(asize, chunk) / WSIZE);
+}
+
+/*
+ * coalesce - coalesces two or more blocks.
+ *            bp points to the payload of the free block.
+ *            Tries to coalesce that block with the one before
+ *            it and the one after it.
+ *            Returns a pointer to the possibly bigger free block.
+ */
+static void *coalesce(void *bp)
+{
+   // TODO
+   // Use the slides to help you figure out how to implement this.
+   // Also take a look at the implicit list code.
+   // removeBlock function is very helpful here.
+   // Macros defined at the top of the file are also very helpful.
+   size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+   size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+   size_t size = GET_SIZE(HDRP(bp));
+
+   // NOTE: In the slides it states the following:
+   // Some extra space for the links (2 extra words
+   // needed for each block)
+   //
+   // This may be important?? - Justin
+
+   // From Norris' email:
+   // In the cases where the previous block is free, you need to remove
+   // it from the free list because the coalesced block that ends up on
+   // the list needs to begin with that block.
+
+   // The lists are picked by block size, so every block that takes part
+   // is spliced out before the sizes change and the result is inserted
+   // again afterwards.
+
+   // case 1: Insert the freed block at the root of the list.
+   if (prev_alloc && next_alloc)
+   {
+      return bp;
+   }
+   // case 2: Splice out the succ block, coalesce both memory
+   // blocks and insert the new block at the root of the list.
    else if (prev_alloc && !next_alloc)
    {
       size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
       removeBlock(NEXT_BLKP(bp));
-      PUT(HDRP(bp), PACK(size, 0));
+      removeBlock(bp);
+      PUT(HDRP(bp), PACK(size, PREV_ALLOC));
+      PUT(FTRP(bp), PACK(size, 0));
+      insertInFront(bp);
+   }
+   // case 3: Splice out the pred block, coalesce both memory
+   // blocks, and insert the new block at the root of the list.
+   else if (!prev_alloc && next_alloc)
+   {
+      size += GET_SIZE(HDRP(PREV_BLKP(bp)));
+      removeBlock(PREV_BLKP(bp));
+      removeBlock(bp);
+      bp = PREV_BLKP(bp);
+      PUT(HDRP(bp), PACK(size, PREV_ALLOC));
       PUT(FTRP(bp), PACK(size, 0));
+      insertInFront(bp);
+   }
+   // case 4: Splice out pred and succ blocks, coalesce all 3 memory
+   // blocks and insert the new block at the root of the list.
+   else
+   {
+
+      size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
+      removeBlock(PREV_BLKP(bp));
+      removeBlock(bp);
+      removeBlock(NEXT_BLKP(bp));
+      bp = PREV_BLKP(bp);
+      PUT(HDRP(bp), PACK(size, PREV_ALLOC));
+      PUT(FTRP(bp), PACK(size, 0));
+      insertInFront(bp);
+   }
+   // removeBlock has already moved current off the blocks that were
+   // joined, so next fit never starts inside bp
+   return bp;
+}
+
+/*
+ * first_fit - Starts at the begining of the list and returns the
+ *             first free block with a size that is greater than or
+ *             equal to asize.
+ *             With segregated fit the search starts at the list for
+ *             the size class of asize and moves on to the lists of
+ *             the bigger classes.
+ *             Returns a pointer to the found block or NULL if no
+ *             block fits.
+ */
+static void *first_fit(size_t asize)
+{
+   char *bp;
+   int c;
+   // firstFree points to the first block in the free list
+   // the successor word in the block points to the next block
+   if (useIndex && ar->idxCount >= 0)
+   {
+      int i = indexFirstFit(ar->idx->size, ar->idxCount, asize);
+      return (i < 0) ? NULL : ar->heap_base + ar->idx->off[i];
+   }
+
+   for (c = sizeClass(asize); c < numClasses; c++)
+   {
+      size_t largest = 0;
+      if (ar->maxFree[c] < asize)
+         continue;
+      for (bp = ar->firstFree[c]; bp != 0; bp = GET_PTR(SUCC(bp)))
+      {
+         if (asize <= GET_SIZE(HDRP(bp)))
+         {
+            return bp;
+         }
+         largest = MAX(largest, GET_SIZE(HDRP(bp)));
+      }
+      // the whole list was walked, so now the bound is exact
+      ar->maxFree[c] = largest;
+   }
+
+   return NULL;
+}
+
+/*
+ * next_fit - Starts at the free block in the list after the last block that
+ *            was allocated and searches in the list for the next block with
+ *            a size that is greater than or equal to asize.  If the end of
+ *            the list is reached the search goes on from the front of the
+ *            list up to where it started.
+ *            Assumes that current is NULL or a free block in the list.
+ *            Returns a pointer to the found block or NULL if no
+ *            block fits.
+ *            Note: current isn't modified by this function.
+ */
+static void *next_fit(size_t asize)
+{
+   char *bp;
+   size_t largest = 0;
+
+   for (bp = ar->current; bp != 0; bp = GET_PTR(SUCC(bp)))
+   {
+      if (asize <= GET_SIZE(HDRP(bp)))
+      {
+         return bp;
+      }
+      largest = MAX(largest, GET_SIZE(HDRP(bp)));
+   }
+
+   // wrap around to the front of the list
+   for (bp = ar->firstFree[0]; bp != ar->current; bp = GET_PTR(SUCC(bp)))
+   {
+      if (asize <= GET_SIZE(HDRP(bp)))
+      {
+         return bp;
+      }
+      largest = MAX(largest, GET_SIZE(HDRP(bp)));
+   }
+
+   // the whole list was walked, so now the bound is exact
+   ar->maxFree[0] = largest;
+   return NULL;
+}
+
+/*
+ * best_fit - Looks for a block of size asize bytes by returning the
+ *            smallest free block that is greater than or equal to asize.
+ *            The blocks that are too small for the tree have a list for
+ *            each size, so the first block in one of those lists is the
+ *            best fit.  Otherwise the tree is searched for the smallest
+ *            block that fits, which is the one with the lowest address
+ *            if there is more than one.
+ *            Returns a pointer to the found block or NULL if no
+ *            block fits.
+ */
+static void *best_fit(size_t asize)
+{
+   char *bp;
+   char *best = NULL;
+   int c;
+
+   if (useIndex && ar->idxCount >= 0)
+   {
+      int i = indexBestFit(ar->idx->size, ar->idxCount, asize);
+      return (i < 0) ? NULL : ar->heap_base + ar->idx->off[i];
+   }
+
+   for (c = sizeClass(asize); c < sizeClass(TREEMIN); c++)
+   {
+      if (ar->firstFree[c] != 0)
+         return ar->firstFree[c];
+   }
+
+   // go left whenever the block fits since the left subtree
+   // can only hold smaller blocks or ones at a lower address
+   bp = ar->treeRoot;
+   while (bp != 0)
+   {
+      if (asize <= GET_SIZE(HDRP(bp)))
+      {
+         best = bp;
+         bp = GET_PTR(LEFT(bp));
+      }
+      else
+      {
+         bp = GET_PTR(RIGHT(bp));
+      }
+   }
+   return best;
+}
+
+// height of a subtree; 0 for an empty tree
+#define TREE_HEIGHT(bp) ((bp) ? (int)GET(HEIGHT(bp)) : 0)
+
+// true if block a comes before block b in the tree
+#define TREE_LESS(a, b) (GET_SIZE(HDRP(a)) < GET_SIZE(HDRP(b)) || \
+                         (GET_SIZE(HDRP(a)) == GET_SIZE(HDRP(b)) && (a) < (b)))
+
+/*
+ * treeInsert - Adds the free block bp to the best fit tree and
+ *              rebalances the tree.
+ */
+static void treeInsert(void *bp)
+{
+   char *parent = 0;
+   char *node = ar->treeRoot;
+
+   while (node != 0)
+   {
+      parent = node;
+      if (TREE_LESS((char *)bp, node))
+         node = GET_PTR(LEFT(node));
+      else
+         node = GET_PTR(RIGHT(node));
+   }
+
+   PUT_PTR(LEFT(bp), 0);
+   PUT_PTR(RIGHT(bp), 0);
+   PUT_PTR(PARENT(bp), parent);
+   PUT(HEIGHT(bp), 1);
+
+   if (parent == 0)
+      ar->treeRoot = bp;
+   else if (TREE_LESS((char *)bp, parent))
+      PUT_PTR(LEFT(parent), bp);
+   else
+      PUT_PTR(RIGHT(parent), bp);
+
+   treeRebalance(parent);
+}
+
+/*
+ * treeRemove - Takes the free block bp out of the best fit tree.
+ *              A block with two children is replaced by the smallest
+ *              block in its right subtree.
+ */
+static void treeRemove(void *bp)
+{
+   char *left = GET_PTR(LEFT(bp));
+   char *right = GET_PTR(RIGHT(bp));
+   char *parent = GET_PTR(PARENT(bp));
+   char *start;
+
+   if (left != 0 && right != 0)
+   {
+      char *next = right;
+      while (GET_PTR(LEFT(next)) != 0)
+         next = GET_PTR(LEFT(next));
+
+      if (next != right)
+      {
+         // splice next out of its spot and give it bp's right subtree
+         char *nextParent = GET_PTR(PARENT(next));
+         char *nextRight = GET_PTR(RIGHT(next));
+         PUT_PTR(LEFT(nextParent), nextRight);
+         if (nextRight != 0)
+            PUT_PTR(PARENT(nextRight), nextParent);
+         PUT_PTR(RIGHT(next), right);
+         PUT_PTR(PARENT(right), next);
+         start = nextParent;
+      }
+      else
+      {
+         start = next;
+      }
+
+      PUT_PTR(LEFT(next), left);
+      PUT_PTR(PARENT(left), next);
+      PUT_PTR(PARENT(next), parent);
+      PUT(HEIGHT(next), GET(HEIGHT(bp)));
+      treeReplace(parent, bp, next);
    }
-   // case 3: Splice out the pred block, coalesce both memory
-   // blocks, and insert the new block at the root of the list.
-   else if (!prev_alloc && next_alloc)
+   else
    {
-      size += GET_SIZE(HDRP(PREV_BLKP(bp)));
-      removeBlock(PREV_BLKP(bp));
-      removeBlock(bp);
-      bp = PREV_BLKP(bp);
-      PUT(HDRP(bp), PACK(size, 0));
-      PUT(FTRP(bp), PACK(size, 0));
-      insertInFront(bp);
+      char *child = (left != 0) ? left : right;
+      if (child != 0)
+         PUT_PTR(PARENT(child), parent);
+      treeReplace(parent, bp, child);
+      start = parent;
    }
-   // case 4: Splice out pred and succ blocks, coalesce all 3 memory
-   // blocks and insert the new block at the root of the list.
+
+   treeRebalance(start);
+}
+
+/*
+ * treeReplace - Makes new the child of parent in place of old.
+ *               If parent is NULL then new becomes the root.
+ */
+static void treeReplace(char *parent, char *old, char *new)
+{
+   if (parent == 0)
+      ar->treeRoot = new;
+   else if (GET_PTR(LEFT(parent)) == old)
+      PUT_PTR(LEFT(parent), new);
    else
+      PUT_PTR(RIGHT(parent), new);
+}
+
+/*
+ * treeFixHeight - Recomputes the height of bp from its children.
+ */
+static void treeFixHeight(char *bp)
+{
+   int left = TREE_HEIGHT(GET_PTR(LEFT(bp)));
+   int right = TREE_HEIGHT(GET_PTR(RIGHT(bp)));
+   PUT(HEIGHT(bp), 1 + MAX(left, right));
+}
+
+/*
+ * treeRotateLeft - Moves the right child of bp up into bp's spot.
+ *                  Returns the new root of the subtree.
+ */
+static char *treeRotateLeft(char *bp)
+{
+   char *child = GET_PTR(RIGHT(bp));
+   char *inner = GET_PTR(LEFT(child));
+   char *parent = GET_PTR(PARENT(bp));
+
+   PUT_PTR(RIGHT(bp), inner);
+   if (inner != 0)
+      PUT_PTR(PARENT(inner), bp);
+   PUT_PTR(LEFT(child), bp);
+   PUT_PTR(PARENT(bp), child);
+   PUT_PTR(PARENT(child), parent);
+   treeReplace(parent, bp, child);
+
+   treeFixHeight(bp);
+   treeFixHeight(child);
+   return child;
+}
+
+/*
+ * treeRotateRight - Moves the left child of bp up into bp's spot.
+ *                   Returns the new root of the subtree.
+ */
+static char *treeRotateRight(char *bp)
+{
+   char *child = GET_PTR(LEFT(bp));
+   char *inner = GET_PTR(RIGHT(child));
+   char *parent = GET_PTR(PARENT(bp));
+
+   PUT_PTR(LEFT(bp), inner);
+   if (inner != 0)
+      PUT_PTR(PARENT(inner), bp);
+   PUT_PTR(RIGHT(child), bp);
+   PUT_PTR(PARENT(bp), child);
+   PUT_PTR(PARENT(child), parent);
+   treeReplace(parent, bp, child);
+
+   treeFixHeight(bp);
+   treeFixHeight(child);
+   return child;
+}
+
+/*
+ * treeRebalance - Walks from bp up to the root fixing the heights and
+ *                 doing the AVL rotations wherever the heights of two
+ *                 subtrees differ by more than one.
+ */
+static void treeRebalance(char *bp)
+{
+   while (bp != 0)
    {
+      char *left = GET_PTR(LEFT(bp));
+      char *right = GET_PTR(RIGHT(bp));
+      int balance = TREE_HEIGHT(left) - TREE_HEIGHT(right);
 
-      size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
-      removeBlock(PREV_BLKP(bp));
-      removeBlock(bp);
-      removeBlock(NEXT_BLKP(bp));
-      bp = PREV_BLKP(bp);
-      PUT(HDRP(bp), PACK(size, 0));
-      PUT(FTRP(bp), PACK(size, 0));
-      insertInFront(bp);
+      if (balance > 1)
+      {
+         // left-right case needs a rotation of the child first
+         if (TREE_HEIGHT(GET_PTR(LEFT(left))) <
+             TREE_HEIGHT(GET_PTR(RIGHT(left))))
+            treeRotateLeft(left);
+         bp = treeRotateRight(bp);
+      }
+      else if (balance < -1)
+      {
+         // right-left case needs a rotation of the child first
+         if (TREE_HEIGHT(GET_PTR(RIGHT(right))) <
+             TREE_HEIGHT(GET_PTR(LEFT(right))))
+            treeRotateRight(right);
+         bp = treeRotateLeft(bp);
+      }
+      else
+      {
+         treeFixHeight(bp);
+      }
+      bp = GET_PTR(PARENT(bp));
    }
-   // If you implement next_fit for extra credit then check to see if
-   // current needs to be modified
-   return bp;
 }
 
 /*
- * first_fit - Starts at the begining of the list and returns the
- *             first free block with a size that is greater than or
- *             equal to asize.
- *             Returns a pointer to the found block or NULL if no
- *             block fits.
+ * treeCheck - Checks the order, parent links and heights of the subtree
+ *             rooted at bp.  Returns the number of blocks in the subtree
+ *             or -1 if something is wrong.
  */
-static void *first_fit(size_t asize)
+static int treeCheck(char *bp, char *parent)
+{
+   int left, right;
+   char *l, *r;
+
+   if (bp == 0)
+      return 0;
+   l = GET_PTR(LEFT(bp));
+   r = GET_PTR(RIGHT(bp));
+   if (GET_PTR(PARENT(bp)) != parent || GET_ALLOC(HDRP(bp)) ||
+       GET_SIZE(HDRP(bp)) < TREEMIN ||
+       (l != 0 && !TREE_LESS(l, bp)) || (r != 0 && !TREE_LESS(bp, r)))
+      return -1;
+   if ((int)GET(HEIGHT(bp)) != 1 + MAX(TREE_HEIGHT(l), TREE_HEIGHT(r)) ||
+       TREE_HEIGHT(l) - TREE_HEIGHT(r) > 1 ||
+       TREE_HEIGHT(r) - TREE_HEIGHT(l) > 1)
+      return -1;
+   left = treeCheck(l, bp);
+   right = treeCheck(r, bp);
+   if (left < 0 || right < 0)
+      return -1;
+   return left + right + 1;
+}
+
+/*
+ * good_fit - Looks for a block of size asize bytes like best fit, but
+ *            gives up after looking at goodProbes free blocks and
+ *            returns the smallest one that fit, so the time spent is
+ *            bounded.  A block that is at most goodSlack percent bigger
+ *            than asize is taken right away.  Good fit uses the
+ *            segregated lists, so the search starts at the list for the
+ *            size class of asize.
+ *            Returns NULL if none of the blocks it looked at fit, and
+ *            the heap is extended.
+ */
+static void *good_fit(size_t asize)
 {
    char *bp;
-   // firstFree points to the first block in the free list
-   // the successor word in the block points to the next block
-   for (bp = firstFree; bp != 0; bp = (char *)GET(SUCC(bp)))
+   char *best = NULL;
+   size_t slack = asize * goodSlack / 100;
+   int probes = 0;
+   int c;
+
+   for (c = sizeClass(asize); c < numClasses; c++)
    {
-      if (asize <= GET_SIZE(HDRP(bp)))
+      if (ar->maxFree[c] < asize)
+         continue;
+      for (bp = ar->firstFree[c]; bp != 0; bp = GET_PTR(SUCC(bp)))
       {
-         return bp;
+         size_t size = GET_SIZE(HDRP(bp));
+         if (probes++ == goodProbes)
+            return best;
+         if (asize <= size && size - asize <= slack)
+            return bp;
+         if (asize <= size && (best == NULL || size < GET_SIZE(HDRP(best))))
+            best = bp;
       }
    }
 
-   return NULL;
+   return best;
 }
 
 /*
- * next_fit - Starts at the free block in the list after the last block that
- *            was allocated and searches in the list for the next block with
- *            a size that is greater than or equal to asize.
- *            Returns a pointer to the found block or NULL if no
- *            block fits.
+ * indexAdd - Adds the free block bp of size bytes to the dense index of
+ *            the arena.  A full index is turned off.
  */
-static void *next_fit(size_t asize)
+static void indexAdd(void *bp, size_t size)
 {
-   // TODO
-   /******** You can implement this for extra credit if you like. ********/
-   return first_fit(asize);
+   unsigned int off = (char *)bp - ar->heap_base;
+
+   if (ar->idxCount < 0)
+      return;
+   if (ar->idxCount == INDEXMAX)
+   {
+      ar->idxCount = -1;
+      return;
+   }
+   ar->idx->size[ar->idxCount] = size;
+   ar->idx->off[ar->idxCount] = off;
+   IDX_SLOT(off) = ar->idxCount;
+   ar->idxCount++;
 }
 
 /*
- * best_fit - Looks for a block of size asize bytes by going through all of
- *            the blocks in the free list and returning the one that is
- *            smallest and also greater than or equal to asize.
- *
+ * indexRemove - Takes the free block bp out of the dense index.  The last
+ *               entry is moved into its slot.
  */
-static void *best_fit(size_t asize)
+static void indexRemove(void *bp)
 {
-   // TODO
-   /******** You can implement this for extra credit if you like. ********/
-   return first_fit(asize);
+   int i;
+
+   if (ar->idxCount < 0)
+      return;
+   i = IDX_SLOT((char *)bp - ar->heap_base);
+   ar->idxCount--;
+   ar->idx->size[i] = ar->idx->size[ar->idxCount];
+   ar->idx->off[i] = ar->idx->off[ar->idxCount];
+   IDX_SLOT(ar->idx->off[i]) = i;
+}
+
+/*
+ * indexReplace - Makes the entry of bp in the dense index the entry of
+ *                the free block nbp of size bytes.  Used when place
+ *                gives the spot of bp in its list to what is left of it.
+ */
+static void indexReplace(void *bp, void *nbp, size_t size)
+{
+   int i;
+
+   if (ar->idxCount < 0)
+      return;
+   i = IDX_SLOT((char *)bp - ar->heap_base);
+   ar->idx->size[i] = size;
+   ar->idx->off[i] = (char *)nbp - ar->heap_base;
+   IDX_SLOT(ar->idx->off[i]) = i;
+}
+
+/*
+ * The scans of the dense index.  Sizes and offsets are less than 2^31,
+ * so the signed compares of SSE2 and AVX2 work for them.  The AVX2
+ * versions are compiled for AVX2 whatever the flags of the rest of the
+ * file are, and only called if the CPU has it.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static int findAVX2(const unsigned int *a, int n, unsigned int key)
+{
+   __m256i k = _mm256_set1_epi32(key);
+   int i, m;
+
+   for (i = 0; i + 8 <= n; i += 8)
+   {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+      m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, k)));
+      if (m != 0)
+         return i + __builtin_ctz(m);
+   }
+   for (; i < n; i++)
+      if (a[i] == key)
+         return i;
+   return -1;
+}
+
+__attribute__((target("avx2")))
+static int firstFitAVX2(const unsigned int *a, int n, unsigned int asize)
+{
+   __m256i k = _mm256_set1_epi32(asize - 1);
+   int i, m;
+
+   for (i = 0; i + 8 <= n; i += 8)
+   {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+      m = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, k)));
+      if (m != 0)
+         return i + __builtin_ctz(m);
+   }
+   for (; i < n; i++)
+      if (a[i] >= asize)
+         return i;
+   return -1;
+}
+
+// smallest size of at least asize; sizes that don't fit count as INT_MAX
+__attribute__((target("avx2")))
+static unsigned int minFitAVX2(const unsigned int *a, int n, unsigned int asize)
+{
+   __m256i k = _mm256_set1_epi32(asize - 1);
+   __m256i none = _mm256_set1_epi32(0x7fffffff);
+   __m256i best = none;
+   unsigned int lane[8];
+   unsigned int min = 0x7fffffff;
+   int i;
+
+   for (i = 0; i + 8 <= n; i += 8)
+   {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+      __m256i fit = _mm256_cmpgt_epi32(v, k);
+      best = _mm256_min_epi32(best, _mm256_blendv_epi8(none, v, fit));
+   }
+   _mm256_storeu_si256((__m256i *)lane, best);
+   for (i = 0; i < 8; i++)
+      min = MIN(min, lane[i]);
+   for (i = n & ~7; i < n; i++)
+      if (a[i] >= asize)
+         min = MIN(min, a[i]);
+   return min;
+}
+
+static int findSSE2(const unsigned int *a, int n, unsigned int key)
+{
+   __m128i k = _mm_set1_epi32(key);
+   int i, m;
+
+   for (i = 0; i + 4 <= n; i += 4)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+      m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, k)));
+      if (m != 0)
+         return i + __builtin_ctz(m);
+   }
+   for (; i < n; i++)
+      if (a[i] == key)
+         return i;
+   return -1;
+}
+
+static int firstFitSSE2(const unsigned int *a, int n, unsigned int asize)
+{
+   __m128i k = _mm_set1_epi32(asize - 1);
+   int i, m;
+
+   for (i = 0; i + 4 <= n; i += 4)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+      m = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k)));
+      if (m != 0)
+         return i + __builtin_ctz(m);
+   }
+   for (; i < n; i++)
+      if (a[i] >= asize)
+         return i;
+   return -1;
+}
+
+// SSE2 has no blend or 32 bit min, so both are done with masks
+static unsigned int minFitSSE2(const unsigned int *a, int n, unsigned int asize)
+{
+   __m128i k = _mm_set1_epi32(asize - 1);
+   __m128i none = _mm_set1_epi32(0x7fffffff);
+   __m128i best = none;
+   unsigned int lane[4];
+   unsigned int min = 0x7fffffff;
+   int i;
+
+   for (i = 0; i + 4 <= n; i += 4)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+      __m128i fit = _mm_cmpgt_epi32(v, k);
+      __m128i cand = _mm_or_si128(_mm_and_si128(fit, v),
+                                  _mm_andnot_si128(fit, none));
+      __m128i less = _mm_cmplt_epi32(cand, best);
+      best = _mm_or_si128(_mm_and_si128(less, cand),
+                          _mm_andnot_si128(less, best));
+   }
+   _mm_storeu_si128((__m128i *)lane, best);
+   for (i = 0; i < 4; i++)
+      min = MIN(min, lane[i]);
+   for (i = n & ~3; i < n; i++)
+      if (a[i] >= asize)
+         min = MIN(min, a[i]);
+   return min;
+}
+#endif
+
+/*
+ * indexFind - Returns the first i with a[i] equal to key, or -1.
+ */
+static int indexFind(const unsigned int *a, int n, unsigned int key)
+{
+   int i;
+
+#if defined(__x86_64__) || defined(__i386__)
+   if (simdLevel == 2)
+      return findAVX2(a, n, key);
+   if (simdLevel == 1)
+      return findSSE2(a, n, key);
+#endif
+   for (i = 0; i < n; i++)
+      if (a[i] == key)
+         return i;
+   return -1;
+}
+
+/*
+ * indexFirstFit - Returns the first i with a[i] of at least asize, or -1.
+ */
+static int indexFirstFit(const unsigned int *a, int n, unsigned int asize)
+{
+   int i;
+
+#if defined(__x86_64__) || defined(__i386__)
+   if (simdLevel == 2)
+      return firstFitAVX2(a, n, asize);
+   if (simdLevel == 1)
+      return firstFitSSE2(a, n, asize);
+#endif
+   for (i = 0; i < n; i++)
+      if (a[i] >= asize)
+         return i;
+   return -1;
+}
+
+/*
+ * indexBestFit - Returns the first i with the smallest a[i] of at least
+ *                asize, or -1.  The vector scans only find that size, and
+ *                indexFind then finds where it is.
+ */
+static int indexBestFit(const unsigned int *a, int n, unsigned int asize)
+{
+   unsigned int min = 0x7fffffff;
+   int i;
+
+#if defined(__x86_64__) || defined(__i386__)
+   if (simdLevel == 2)
+      min = minFitAVX2(a, n, asize);
+   else if (simdLevel == 1)
+      min = minFitSSE2(a, n, asize);
+   else
+#endif
+   {
+      for (i = 0; i < n; i++)
+         if (a[i] >= asize)
+            min = MIN(min, a[i]);
+   }
+
+   if (min == 0x7fffffff)
+      return -1;
+   return indexFind(a, n, min);
 }
 
 /*
- * place - Adds a header and footer to allocated block. If the block
+ * place - Adds a header to allocated block. If the block
  *         is larger than needed and the leftover portion is at
  *         least the minimum block size then mark the remaining portion
  *         as a free block and add it to the free list (but not in
@@ -489,41 +2615,65 @@ static void place(void *bp, size_t asize)
 {
    // get the size of the free block
    size_t csize = GET_SIZE(HDRP(bp));
-   unsigned int *pred = (unsigned int *)GET(PRED(bp));
-   unsigned int *succ = (unsigned int *)GET(SUCC(bp));
+   char *pred = GET_PTR(PRED(bp));
+   char *succ = GET_PTR(SUCC(bp));
+   size_t prev = GET_PREV_ALLOC(HDRP(bp));
+   int c = sizeClass(csize);
 
+   // if the leftover block belongs in another size class, then
+   // it can't take over the spot of bp in its list.  The tree is
+   // ordered by size, so the leftover block never keeps the spot there.
+   if ((csize - asize) >= SPLITMIN &&
+       (useTree || sizeClass(csize - asize) != c))
+   {
+      removeBlock(bp);
+      PUT(HDRP(bp), PACK(asize, prev | 1));
+      void *nxtbp = NEXT_BLKP(bp);
+      PUT(HDRP(nxtbp), PACK(csize - asize, PREV_ALLOC));
+      PUT(FTRP(nxtbp), PACK(csize - asize, 0));
+      insertInFront(nxtbp);
+   }
    // if the unused portion is at least 2*DSIZE
    // then split the block into two
-   if ((csize - asize) >= (2 * DSIZE))
+   else if ((csize - asize) >= SPLITMIN)
    {
-      // add the header and footer to the allocated block
-      PUT(HDRP(bp), PACK(asize, 1));
-      PUT(FTRP(bp), PACK(asize, 1));
+      // add the header to the allocated block
+      PUT(HDRP(bp), PACK(asize, prev | 1));
       void *nxtbp = NEXT_BLKP(bp);
-      PUT(HDRP(nxtbp), PACK(csize - asize, 0));
+      PUT(HDRP(nxtbp), PACK(csize - asize, PREV_ALLOC));
       PUT(FTRP(nxtbp), PACK(csize - asize, 0));
 
       if (pred != 0)
-         PUT(SUCC(pred), (unsigned int)nxtbp);
+         PUT_PTR(SUCC(pred), nxtbp);
       if (succ != 0)
-         PUT(PRED(succ), (unsigned int)nxtbp);
+         PUT_PTR(PRED(succ), nxtbp);
 
-      if (firstFree == bp)
-         firstFree = (char *)nxtbp;
-      PUT(PRED(nxtbp), (unsigned int)pred);
+      if (ar->firstFree[c] == bp)
+         ar->firstFree[c] = (char *)nxtbp;
+      if (WHICHORDER == ADDRORDER)
+      {
+         addrClear(bp, c);
+         addrSet(nxtbp, c);
+      }
+      // the next search starts at what is left of bp
+      if (ar->current == bp)
+         ar->current = (char *)nxtbp;
+      if (useIndex)
+         indexReplace(bp, nxtbp, csize - asize);
+      PUT_PTR(PRED(nxtbp), pred);
 
       // add the header and footer to the unallocated block
-      if (bp == lastFree)
-         lastFree = (char *)nxtbp;
-      PUT(SUCC(nxtbp), (unsigned int)succ);
+      if (bp == ar->lastFree[c])
+         ar->lastFree[c] = (char *)nxtbp;
+      PUT_PTR(SUCC(nxtbp), succ);
    }
    else
    {
       // remove entire block from the free list
       removeBlock(bp);
-      // add the header and footer
-      PUT(HDRP(bp), PACK(csize, 1));
-      PUT(FTRP(bp), PACK(csize, 1));
+      // add the header and tell the next block
+      PUT(HDRP(bp), PACK(csize, prev | 1));
+      SET_PREV_ALLOC(NEXT_BLKP(bp));
    }
 }
 
@@ -531,11 +2681,15 @@ static void place(void *bp, size_t asize)
  * removeBlock - Takes as input a pointer to a free block and removes it
  *               from the explicit list by adjusting the pointers in the
  *               previous and next blocks.
- *               Will also change the values of firstFree and lastFree if
- *               the first block and/or the last block are being removed.
+ *               Will also change the values of firstFree and lastFree of
+ *               the block's size class if the first block and/or the
+ *               last block are being removed.
+ *               The block must still have the size it was inserted with.
  */
 static void removeBlock(void *bp)
 {
+   int c = sizeClass(GET_SIZE(HDRP(bp)));
+
    // TODO
    // Remove a block by changing the pointers in the previous
    // block and the next block (if present) so that they point to each
@@ -543,38 +2697,70 @@ static void removeBlock(void *bp)
    //
    // You may also need to change firstFree and/or lastFree.
 
-   char *previousElement = (char *)GET(PRED(bp));
-   char *nextElement = (char *)GET(SUCC(bp));
+   if (useTree && GET_SIZE(HDRP(bp)) >= TREEMIN)
+      treeRemove(bp);
+   if (useIndex)
+      indexRemove(bp);
+
+   char *previousElement = GET_PTR(PRED(bp));
+   char *nextElement = GET_PTR(SUCC(bp));
+   if (WHICHORDER == ADDRORDER)
+      addrClear(bp, c);
+   // next fit goes on with the block after bp
+   if (ar->current == bp)
+   {
+      ar->current = nextElement;
+   }
    if (previousElement)
    {
-      PUT(SUCC(previousElement), (unsigned int)nextElement);
+      PUT_PTR(SUCC(previousElement), nextElement);
    }
    else
    {
-      firstFree = nextElement;
+      ar->firstFree[c] = nextElement;
+      if (nextElement == 0)
+         ar->maxFree[c] = 0; // the list is empty
    }
    if (nextElement)
    {
-      PUT(PRED(nextElement), (unsigned int)previousElement);
+      PUT_PTR(PRED(nextElement), previousElement);
    }
    else
    {
-      lastFree = previousElement;
+      ar->lastFree[c] = previousElement;
    }
 }
 
 /*
  * printBlocks - Prints the entire heap indicating which blocks are
- *               allocated and which are free.
+ *               allocated and which are free.  Arenas that haven't
+ *               been set up are skipped.
  */
 void printBlocks()
+{
+   int a;
+   for (a = 0; a < NUMARENAS; a++)
+   {
+      ar = &arenas[a];
+      if (ar->heap_listp == NULL)
+         continue;
+      if (NUMARENAS > 1)
+         printf("Arena %d\n", a);
+      printArenaBlocks();
+   }
+}
+
+/*
+ * printArenaBlocks - Prints every block in arena ar.
+ */
+static void printArenaBlocks(void)
 {
    char *bp;
    printf("Entire heap\n");
-   printf("%10s %10s %1s %10s %10s\n", "Addr", "Size", "a", "Pred", "Succ");
-   for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+   printf("%14s %10s %1s %10s %10s\n", "Addr", "Size", "a", "Pred", "Succ");
+   for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
    {
-      printf("%#10x %#10x %d ", (unsigned int)bp, GET_SIZE(HDRP(bp)),
+      printf("%14p %#10x %d ", bp, GET_SIZE(HDRP(bp)),
              GET_ALLOC(HDRP(bp)));
       if (!GET_ALLOC(HDRP(bp)))
          printf("%#10x %#10x", GET(PRED(bp)), GET(SUCC(bp)));
@@ -587,18 +2773,248 @@ void printBlocks()
  *                 in which they are in the free list.
  */
 void printFreeList()
+{
+   int a;
+   for (a = 0; a < NUMARENAS; a++)
+   {
+      ar = &arenas[a];
+      if (ar->heap_listp == NULL)
+         continue;
+      if (NUMARENAS > 1)
+         printf("Arena %d\n", a);
+      printArenaFreeList();
+   }
+}
+
+/*
+ * printArenaFreeList - Prints the free lists of arena ar.
+ */
+static void printArenaFreeList(void)
 {
    char *bp;
-   printf("Free list\n");
-   printf("%10s %10s %1s %10s %10s\n", "Addr", "Size", "a", "Pred", "Succ");
-   for (bp = firstFree; bp != 0; bp = (char *)GET(SUCC(bp)))
+   int c;
+   for (c = 0; c < numClasses; c++)
    {
-      printf("%#10x %#10x %d ", (unsigned int)bp, GET_SIZE(HDRP(bp)),
-             GET_ALLOC(HDRP(bp)));
+      // only the lists that have blocks are shown for segregated fit
+      if (numClasses > 1 && ar->firstFree[c] == 0)
+         continue;
+      if (numClasses > 1)
+         printf("Free list %d\n", c);
+      else
+         printf("Free list\n");
+      printf("%14s %10s %1s %10s %10s\n", "Addr", "Size", "a", "Pred", "Succ");
+      for (bp = ar->firstFree[c]; bp != 0; bp = GET_PTR(SUCC(bp)))
+      {
+         printf("%14p %#10x %d ", bp, GET_SIZE(HDRP(bp)),
+                GET_ALLOC(HDRP(bp)));
+         if (!GET_ALLOC(HDRP(bp)))
+            printf("%#10x %#10x", GET(PRED(bp)), GET(SUCC(bp)));
+         printf("\n");
+      }
+      printf("firstFree: %p, lastFree: %p\n", ar->firstFree[c], ar->lastFree[c]);
+   }
+}
+
+/*
+ * mm_check - Checks the heap for consistency.  Every free block must have
+ *            matching header and footer, every prev-alloc bit must match
+ *            the block before it, no two free blocks can be next
+ *            to each other, and every free block must be in the list of
+ *            its size class exactly once, in address order and in the
+ *            address map if whichorder is ADDRORDER.  With best fit the tree must be
+ *            a valid AVL tree holding every free block of TREEMIN bytes
+ *            or more.  Blocks in the fast bins must be allocated and in
+ *            the bin of their size, and the free count of every slab must
+ *            match its free map.  Every arena that has been set up is
+ *            checked.
+ *            Returns 1 if the heap is consistent and 0 otherwise.
+ */
+int mm_check()
+{
+   int a;
+   for (a = 0; a < NUMARENAS; a++)
+   {
+      ar = &arenas[a];
+      if (ar->heap_listp != NULL && !arenaCheck())
+         return 0;
+   }
+   return 1;
+}
+
+/*
+ * arenaCheck - Checks arena ar the way mm_check describes.
+ *              Returns 1 if it is consistent and 0 otherwise.
+ */
+static int arenaCheck(void)
+{
+   char *bp, *epilogue;
+   int c;
+   int heapFree = 0;
+   int listFree = 0;
+   int treeFree = 0;
+   int sawCurrent = (ar->current == 0);
+
+   int prevAlloc = 1;
+
+   for (bp = ar->heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+   {
+      if ((GET_PREV_ALLOC(HDRP(bp)) != 0) != prevAlloc)
+      {
+         printf("mm_check: prev-alloc bit of %p is wrong\n", bp);
+         return 0;
+      }
+      prevAlloc = GET_ALLOC(HDRP(bp));
       if (!GET_ALLOC(HDRP(bp)))
-         printf("%#10x %#10x", GET(PRED(bp)), GET(SUCC(bp)));
-      printf("\n");
+      {
+         if (GET_SIZE(HDRP(bp)) != GET_SIZE(FTRP(bp)) || GET_ALLOC(FTRP(bp)))
+         {
+            printf("mm_check: header and footer of %p don't match\n", bp);
+            return 0;
+         }
+         heapFree++;
+         if (GET_SIZE(HDRP(bp)) >= TREEMIN)
+            treeFree++;
+         if (!GET_ALLOC(HDRP(NEXT_BLKP(bp))))
+         {
+            printf("mm_check: free block %p was not coalesced\n", bp);
+            return 0;
+         }
+      }
+   }
+   if ((GET_PREV_ALLOC(HDRP(bp)) != 0) != prevAlloc)
+   {
+      printf("mm_check: prev-alloc bit of the epilogue is wrong\n");
+      return 0;
+   }
+   epilogue = bp;
+
+   for (c = 0; c < numClasses; c++)
+   {
+      char *prev = 0;
+      for (bp = ar->firstFree[c]; bp != 0; bp = GET_PTR(SUCC(bp)))
+      {
+         if (GET_ALLOC(HDRP(bp)) || sizeClass(GET_SIZE(HDRP(bp))) != c)
+         {
+            printf("mm_check: block %p doesn't belong in list %d\n", bp, c);
+            return 0;
+         }
+         if (GET_PTR(PRED(bp)) != prev)
+         {
+            printf("mm_check: bad predecessor in block %p\n", bp);
+            return 0;
+         }
+         if (WHICHORDER == ADDRORDER && prev != 0 && prev > bp)
+         {
+            printf("mm_check: list %d is not in address order at %p\n", c, bp);
+            return 0;
+         }
+         // the address map has no blocks between prev and bp
+         if (WHICHORDER == ADDRORDER && addrPrev(bp, c) != prev)
+         {
+            printf("mm_check: address map of list %d is wrong before %p\n",
+                   c, bp);
+            return 0;
+         }
+         if (bp == ar->current)
+            sawCurrent = 1;
+         if (GET_SIZE(HDRP(bp)) > ar->maxFree[c])
+         {
+            printf("mm_check: block %p is bigger than maxFree of list %d\n",
+                   bp, c);
+            return 0;
+         }
+         prev = bp;
+         listFree++;
+      }
+      if (ar->lastFree[c] != prev)
+      {
+         printf("mm_check: lastFree of list %d is wrong\n", c);
+         return 0;
+      }
+      if (WHICHORDER == ADDRORDER && addrPrev(HDRP(epilogue), c) != prev)
+      {
+         printf("mm_check: address map of list %d is wrong at the end\n", c);
+         return 0;
+      }
+   }
+
+   if (!sawCurrent)
+   {
+      printf("mm_check: next fit rover %p isn't in a free list\n", ar->current);
+      return 0;
+   }
+   if (heapFree != listFree)
+   {
+      printf("mm_check: %d free blocks in the heap but %d in the lists\n",
+             heapFree, listFree);
+      return 0;
+   }
+   if (useTree && treeCheck(ar->treeRoot, 0) != treeFree)
+   {
+      printf("mm_check: best fit tree is broken\n");
+      return 0;
+   }
+
+   // the dense index has an entry with the right size for every free block
+   if (useIndex && ar->idxCount >= 0)
+   {
+      if (ar->idxCount != heapFree)
+      {
+         printf("mm_check: %d free blocks in the heap but %d in the index\n",
+                heapFree, ar->idxCount);
+         return 0;
+      }
+      for (c = 0; c < ar->idxCount; c++)
+      {
+         bp = ar->heap_base + ar->idx->off[c];
+         if (GET_ALLOC(HDRP(bp)) || GET_SIZE(HDRP(bp)) != ar->idx->size[c] ||
+             IDX_SLOT(ar->idx->off[c]) != c)
+         {
+            printf("mm_check: index entry %d for %p is wrong\n", c, bp);
+            return 0;
+         }
+      }
+   }
+
+   // blocks in the fast bins stay allocated and have their bin's size
+   listFree = 0;
+   for (c = 0; c < NUMFAST; c++)
+   {
+      for (bp = ar->fastBin[c]; bp != 0; bp = GET_PTR(PRED(bp)))
+      {
+         if (!GET_ALLOC(HDRP(bp)) || FAST_BIN(GET_SIZE(HDRP(bp))) != c)
+         {
+            printf("mm_check: block %p doesn't belong in fast bin %d\n", bp, c);
+            return 0;
+         }
+         listFree++;
+      }
+   }
+   if (listFree != ar->fastCount)
+   {
+      printf("mm_check: %d blocks in the fast bins but fastCount is %d\n",
+             listFree, ar->fastCount);
+      return 0;
+   }
+
+   // every slab in a list is marked, is the right size and has as many
+   // free objects as its free map says
+   for (c = 0; c < NUMSLABS; c++)
+   {
+      struct slab *sl;
+      for (sl = ar->slabs[c]; sl != NULL; sl = sl->next)
+      {
+         int w;
+         unsigned int n = 0;
+         for (w = 0; w < SLAB_WORDS; w++)
+            n += __builtin_popcountll(sl->freeMap[w]);
+         if (!isSlab(ar - arenas, sl) || sl->size != slabSize[c] ||
+             sl->nfree == 0 || sl->nfree != n)
+         {
+            printf("mm_check: slab %p is broken\n", sl);
+            return 0;
+         }
+      }
    }
-   printf("firstFree: %x, lastFree: %x\n", (unsigned int)firstFree,
-          (unsigned int)lastFree);
+   return 1;
 }
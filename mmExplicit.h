@@ -2,6 +2,10 @@
 #define FIRSTFIT 1
 #define NEXTFIT 2
 #define BESTFIT 3
+#define SEGFIT 4
+#define GOODFIT 5
+#define LIFO 1
+#define ADDRORDER 2
 
 extern int mm_init(void);
 extern void *mm_malloc(size_t size);
@@ -11,3 +15,13 @@ extern int mm_check();
 extern void printBlocks();
 extern void printFreeList();
 extern int whichfit;
+extern int goodProbes;
+extern int goodSlack;
+extern int whichorder;
+extern int useFastBins;
+extern int useSlabs;
+extern int useIndex;
+extern int growthPercent;
+extern int trimThreshold;
+extern int mmapThreshold;
+extern size_t reallocCopied;
@@ -18,19 +18,26 @@
 #include <assert.h>
 #include <unistd.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "mmImplicit.h"
 #include "memlib.h"
+#include "config.h"
 /*
  * Each block has header and footer of the form:
  *
  *      31                     3  2  1  0
  *      -----------------------------------
- *     | s  s  s  s  ... s  s  s  0  0  a/f
+ *     | s  s  s  s  ... s  s  s  m  p  a/f
  *      -----------------------------------
  *
  * where s are the meaningful size bits and a/f is set
- * if the block is allocated. The list has the following form:
+ * if the block is allocated.  p is set in a header if the block
+ * before it is allocated.  m is set in the header of an allocated
+ * block that is in a mapping of its own instead of the heap (see
+ * mapBlock); s is then the size of the mapping.  Only free blocks
+ * have the footer; an allocated block uses that word for its payload.
+ * The list has the following form:
  *
  * begin                                                          end
  * heap                                                           heap
@@ -43,20 +50,60 @@
  * The allocated prologue and epilogue blocks are overhead that
  * eliminate edge conditions during coalescing.
  *
- * The code targets an X86 32-bit machine, which means double word
+ * The code runs on 32 and 64-bit X86 machines and uses double word
  * alignment.  Each block is a multiple of 8 bytes in size and the
  * address of the payload is a multiple of 8.  Headers and footers
- * are 4 bytes each.
+ * are 4 bytes each.  The smallest block is 16 bytes so that it still
+ * has room for a footer when it is freed.
+ *
+ * If useFastBins is set, freed blocks of up to FASTMAX bytes are not
+ * coalesced.  They stay marked allocated and are pushed onto a list of
+ * blocks of exactly their size (a fast bin), so the next request for that
+ * size is a pop.  The fast bins are emptied into the heap, coalescing as
+ * usual, when a search for a free block fails.
+ *
+ * No free block is bigger than maxFree.  coalesce raises it when it
+ * makes a bigger free block, and a search that walks the whole heap
+ * without finding a fit makes it exact again, so a request that can't
+ * fit anywhere goes straight to extend_heap.
+ *
+ * If useFitTree is set, first fit doesn't walk the heap.  A max tree over
+ * the heap has a leaf for every 16 bytes holding the size of the free
+ * block that starts there, and every other node holds the largest size
+ * below it.  The lowest free block that fits is found by going left from
+ * the root whenever the left child is big enough, in O(log n) steps.
+ * place, coalesce and extend_heap keep the leaves up to date.  The tree
+ * is mapped by mm_init only when useFitTree is set, and unmapped by the
+ * next mm_init without it.
+ *
+ * If useBitmap is set, a bitmap with a bit for every 8 bytes of the heap
+ * marks where the free blocks start, and a summary bitmap has a bit for
+ * every word of it that isn't 0.  The searches go from one free block
+ * to the next with bit scans instead of reading the header of every
+ * allocated block in between.
+ *
+ * When nothing fits, the heap only grows by what the free block at its
+ * end (if there is one) is missing.  Otherwise it grows by CHUNKSIZE, or
+ * with growthPercent set by that percent of the heap size (at most
+ * CHUNKMAX), so a heap that keeps growing calls mem_sbrk less often.
+ *
+ * With trimThreshold set, freeing a block that leaves a free block of at
+ * least that many bytes gives memory back.  A free block at the end of
+ * the heap is cut down to CHUNKSIZE with a negative mem_sbrk.  The pages
+ * inside any other free block are released with mem_release; they stay
+ * in the heap and come back as zeros when the block is used again.
  */
 
 // MACROS
 #define WSIZE 4 // size of header and footer
 #define DSIZE 8 // used for alignment
 #define CHUNKSIZE (1 << 12)
+#define CHUNKMAX (1 << 18) // largest chunk growthPercent asks for
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
 
-// create a header or footer by ORing the size and allocation bit
+// create a header or footer by ORing the size and allocation bits
 #define PACK(size, alloc) ((size) | (alloc))
 
 // get the word (i.e., unsigned int) stored in address p
@@ -71,37 +118,140 @@
 // get the allocation bit out of the header or footer
 #define GET_ALLOC(p) (GET(p) & 0x1)
 
+// bit 1 of a header is set if the previous block in memory is allocated.
+// Allocated blocks don't have a footer, so this bit is the only way to
+// tell whether the previous block is free without following PREV_BLKP.
+#define PREV_ALLOC 0x2
+#define GET_PREV_ALLOC(p) (GET(p) & PREV_ALLOC)
+// set or clear the prev-alloc bit in the header of block bp
+#define SET_PREV_ALLOC(bp) PUT(HDRP(bp), GET(HDRP(bp)) | PREV_ALLOC)
+#define CLEAR_PREV_ALLOC(bp) PUT(HDRP(bp), GET(HDRP(bp)) & ~PREV_ALLOC)
+
+// bit 2 of a header is set if the block is in a mapping of its own
+// (see mapBlock); its size is then the size of the mapping
+#define MAPPED 0x4
+#define GET_MAPPED(p) (GET(p) & MAPPED)
+// bytes of mapping a block of asize bytes needs
+#define MAP_SIZE(asize) (((asize) + WSIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1))
+
 // bp is the address of the payload
 // HDRP returns the address of the header, which starts four bytes before payload
 #define HDRP(bp) ((char *)(bp)-WSIZE)
 // FTRP returns the address of the footer; uses size in header to calc address
+// only free blocks have a footer
 #define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
 
 // bp is the pointer to the payload
 // NEXT_BLKP returns a pointer to the payload of the next block
 #define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(((char *)(bp)-WSIZE)))
 // PREV_BLKP returns a pointer to the payload of the previous block
-// accesses the footer in the previous block to get the size of that block
+// accesses the footer in the previous block to get the size of that block,
+// so it can only be used if the previous block is free
 #define PREV_BLKP(bp) ((char *)(bp)-GET_SIZE(((char *)(bp)-DSIZE)))
 
+// Fast bins hold freed blocks of 16 to FASTMAX bytes, one bin per size.
+// A block in a fast bin points to the next one with its first 8 bytes.
+#define FASTMAX (8 * DSIZE)
+#define NUMFAST (FASTMAX / DSIZE - 1)
+#define FAST_BIN(size) ((size) / DSIZE - 2)
+#define FAST_NEXT(bp) (*(char **)(bp))
+
+// The fit tree has a leaf for every TREE_GRAIN bytes of the heap.  Blocks
+// are at least that big, so no two blocks start in the same leaf; bit 0 of
+// a leaf is set if the payload is in the second half of its 16 bytes.
+// Node i has children 2i and 2i+1, and leaves start at index treeLeaves.
+#define TREE_GRAIN (2 * DSIZE)
+#define TREE_MAXLEAVES (1 << 21)
+#if MAX_HEAP / TREE_GRAIN > TREE_MAXLEAVES
+#error "TREE_MAXLEAVES doesn't cover MAX_HEAP"
+#endif
+
+// The free map has a bit for every DSIZE bytes of the heap, set where a
+// free block's payload starts.  Bit i of the summary is set if word i
+// of the free map isn't 0.
+#define MAP_WORDS (MAX_HEAP / DSIZE / 64 + 1)
+#define SUMMARY_WORDS (MAP_WORDS / 64 + 1)
+// FREE_FROM returns the first free block at or after bp with the free
+// map, and bp itself without it; the loop still checks the block
+#define FREE_FROM(bp) (useBitmap ? nextFree(bp) : (char *)(bp))
+
 // Memory Pointers
 // Points to the beginning of the heap (payload/footer of prologue block)
 static char *heap_listp;
 // Points to the block after the last allocated block; used for next fit
 static char *current;
+// Points to the first block in each fast bin
+static char *fastBin[NUMFAST];
+// number of blocks in all the fast bins
+static int fastCount;
+// no free block is bigger than this
+static size_t maxFree;
+// the fit tree and how many of its leaves are in use (a power of 2);
+// the tree is only mapped while useFitTree is set
+static unsigned int *fitTree;
+static size_t treeLeaves;
+// the free map, its summary and how many words of the map may have bits
+static unsigned long long freeMap[MAP_WORDS];
+static unsigned long long freeSummary[SUMMARY_WORDS];
+static size_t mapWords;
 
 // Helper Functions
 static void *extend_heap(size_t words);
+static void *growHeap(size_t asize);
 static void *coalesce(void *bp);
 static void *first_fit(size_t asize);
 static void *next_fit(size_t asize);
 static void *best_fit(size_t asize);
+static void *good_fit(size_t asize);
+static void *find_fit(size_t asize);
+static void *freeBlock(void *bp);
+static void trim(void *bp, void *freed, size_t fsize);
+static void *mapBlock(size_t asize);
+static void unmapBlock(void *bp);
+static void *remapBlock(void *bp, size_t asize);
+static void consolidate(void);
 static void place(void *bp, size_t asize);
+static size_t adjustSize(size_t size);
+static int resizeInPlace(void *bp, size_t asize);
+static void markFree(void *bp, size_t size);
+static char *nextFree(void *bp);
+static void treeSet(void *bp, size_t size);
+static void treeGrow(void);
+static void *treeFit(size_t asize);
 
 /* which placement technique to use */
 /* default is first fit */
 int whichfit = FIRSTFIT;
 
+/* good fit looks at no more than goodProbes free blocks and takes */
+/* the first one that is at most goodSlack percent too big */
+int goodProbes = 8;
+int goodSlack = 10;
+
+/* set to keep small freed blocks in fast bins */
+int useFastBins = 0;
+
+/* set to find first fit blocks with the fit tree */
+int useFitTree = 0;
+
+/* set to skip allocated blocks in the searches with the free map */
+int useBitmap = 0;
+
+/* if not 0, the heap grows by this percent of its size when nothing */
+/* fits instead of by CHUNKSIZE */
+int growthPercent = 0;
+
+/* if not 0, free blocks of at least this many bytes are given back */
+/* to the OS */
+int trimThreshold = 0;
+
+/* if not 0, requests of at least this many bytes get a mapping of */
+/* their own instead of a block in the heap */
+int mmapThreshold = 0;
+
+/* bytes mm_realloc has copied from one block to another */
+size_t reallocCopied = 0;
+
 /*
  * mm_init - initialize the malloc package for implict list
  *           allocation. Specifically, initialize the heap
@@ -112,13 +262,30 @@ int whichfit = FIRSTFIT;
  */
 int mm_init(void)
 {
+	// the fit tree and the free map only cover MAX_HEAP bytes
+	if ((useFitTree || useBitmap) && mem_max_heapsize() > MAX_HEAP)
+		return -1;
+	if (useFitTree && fitTree == NULL)
+	{
+		void *tree = mmap(NULL, 2 * TREE_MAXLEAVES * sizeof(fitTree[0]),
+						  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (tree == MAP_FAILED)
+			return -1;
+		fitTree = tree;
+	}
+	else if (!useFitTree && fitTree != NULL)
+	{
+		// a heap without the tree doesn't keep it around
+		munmap(fitTree, 2 * TREE_MAXLEAVES * sizeof(fitTree[0]));
+		fitTree = NULL;
+	}
 	if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
 		return -1;
 
-	PUT(heap_listp, 0);							   // Padding
-	PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, 1)); // Prologue header
-	PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1)); // Prologue footer
-	PUT(heap_listp + (3 * WSIZE), PACK(0, 1));	   // Epilogue header
+	PUT(heap_listp, 0);                                         // Padding
+	PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, PREV_ALLOC | 1)); // Prologue header
+	PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1));              // Prologue footer
+	PUT(heap_listp + (3 * WSIZE), PACK(0, PREV_ALLOC | 1));     // Epilogue header
 
 	// Make heap_listp point to payload/footer of Prologue block
 	// This enables the code to use the header of the Prologue block
@@ -126,6 +293,13 @@ int mm_init(void)
 	heap_listp += (2 * WSIZE);
 
 	current = NEXT_BLKP(heap_listp); // for next fit placement
+	memset(fastBin, 0, sizeof(fastBin));
+	fastCount = 0;
+	maxFree = 0;
+	treeLeaves = 0; // rebuilt by the first extend_heap
+	memset(freeMap, 0, mapWords * sizeof(freeMap[0]));
+	memset(freeSummary, 0, (mapWords / 64 + 1) * sizeof(freeSummary[0]));
+	mapWords = 0;
 
 	// now add a big free block
 	if (extend_heap(CHUNKSIZE / WSIZE) == NULL)
@@ -143,33 +317,40 @@ int mm_init(void)
 void *mm_malloc(size_t size)
 {
 	size_t asize;
-	size_t extendsize;
 	char *bp;
 
 	if (size == 0)
 		return NULL;
 
-	// Adjust the size to make room for the header and
-	// footer and adhere to the alignment restrictions.
-	// The block must be a size that is a multiple of DSIZE
-	if (size <= DSIZE)
+	asize = adjustSize(size);
+
+	// big requests get a mapping of their own if there is one to be had
+	if (mmapThreshold > 0 && asize >= (size_t)mmapThreshold &&
+	    (bp = mapBlock(asize)) != NULL)
+		return bp;
+
+	// a block of exactly the right size may be waiting in a fast bin
+	if (useFastBins && asize <= FASTMAX && fastBin[FAST_BIN(asize)] != NULL)
 	{
-		// minimum block size is 2*DSIZE
-		asize = 2 * DSIZE;
+		bp = fastBin[FAST_BIN(asize)];
+		fastBin[FAST_BIN(asize)] = FAST_NEXT(bp);
+		fastCount--;
+		return bp;
 	}
-	else
+
+	// Search free list for fit.  If nothing fits, coalesce the blocks
+	// in the fast bins and look again before growing the heap.
+	bp = find_fit(asize);
+	if (bp == NULL && fastCount > 0)
 	{
-		// size must be a multiple of DSIZE
-		asize = DSIZE * ((size + (DSIZE) + (DSIZE - 1)) / DSIZE);
+		consolidate();
+		bp = find_fit(asize);
 	}
-
-	// Search free list for fit.
-	if (whichfit == BESTFIT)
-		bp = best_fit(asize);
-	else if (whichfit == NEXTFIT)
-		bp = next_fit(asize);
-	else
-		bp = first_fit(asize); // default
+	// good fit only looked at a few blocks; when the heap can't grow
+	// any more, look at all of them before giving up
+	if (bp == NULL && whichfit == GOODFIT &&
+	    mem_max_heapsize() - mem_heapsize() < asize)
+		bp = first_fit(asize);
 
 	// If a free block was found then use it
 	if (bp != NULL)
@@ -180,8 +361,7 @@ void *mm_malloc(size_t size)
 	}
 
 	// No free block found, extend the heap
-	extendsize = MAX(asize, CHUNKSIZE);
-	if ((bp = extend_heap(extendsize / WSIZE)) == NULL)
+	if ((bp = growHeap(asize)) == NULL)
 	{
 		return NULL;
 	}
@@ -195,20 +375,175 @@ void *mm_malloc(size_t size)
 /*
  * mm_free - Free the block and coalesce it with adjacent free blocks.
  *           ptr points to the payload of the block to be free.
+ *           Small blocks go into a fast bin instead if useFastBins
+ *           is set.
  */
 void mm_free(void *ptr)
 {
 	size_t size = GET_SIZE(HDRP(ptr));
 
-	PUT(HDRP(ptr), PACK(size, 0));
-	PUT(FTRP(ptr), PACK(size, 0));
+	if (GET_MAPPED(HDRP(ptr)))
+	{
+		unmapBlock(ptr);
+		return;
+	}
+
+	if (useFastBins && size <= FASTMAX)
+	{
+		FAST_NEXT(ptr) = fastBin[FAST_BIN(size)];
+		fastBin[FAST_BIN(size)] = ptr;
+		fastCount++;
+		return;
+	}
+	trim(freeBlock(ptr), ptr, size);
+}
+
+/*
+ * freeBlock - Marks the block bp free and coalesces it with the
+ *             blocks next to it.
+ *             Returns a pointer to the coalesced block.
+ */
+static void *freeBlock(void *bp)
+{
+	size_t size = GET_SIZE(HDRP(bp));
+
+	PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+	PUT(FTRP(bp), PACK(size, 0));
+	CLEAR_PREV_ALLOC(NEXT_BLKP(bp));
+
+	return coalesce(bp);
+}
+
+/*
+ * mapBlock - Gives a block for asize bytes its own mapping outside the
+ *            heap.  The payload starts DSIZE bytes into the mapping so
+ *            it is aligned, and the header holds the mapping size.
+ *            Returns NULL if there is no mapping to be had.
+ */
+static void *mapBlock(size_t asize)
+{
+	size_t msize = MAP_SIZE(asize);
+	char *bp;
+
+	if ((bp = mem_map(msize)) == NULL)
+		return NULL;
+	bp += DSIZE;
+	PUT(HDRP(bp), PACK(msize, MAPPED | 1));
+	return bp;
+}
 
-	coalesce(ptr);
+/*
+ * unmapBlock - Gives the mapping of block bp back right away.
+ */
+static void unmapBlock(void *bp)
+{
+	mem_unmap((char *)bp - DSIZE, GET_SIZE(HDRP(bp)));
 }
 
 /*
- * mm_realloc - Allocate a new block of size bytes.  Copy the contents
- *              of the block pointed to by ptr into that block.
+ * remapBlock - Resizes the mapping of block bp to hold asize bytes with
+ *              mremap, which moves page table entries instead of
+ *              copying the payload.  Returns the block's new address,
+ *              which may be different, or NULL if the mapping can't be
+ *              resized.
+ */
+static void *remapBlock(void *bp, size_t asize)
+{
+	size_t msize = MAP_SIZE(asize);
+	char *lo;
+
+	if (msize == GET_SIZE(HDRP(bp)))
+		return bp;
+	if ((lo = mem_remap((char *)bp - DSIZE, GET_SIZE(HDRP(bp)), msize)) == NULL)
+		return NULL;
+	bp = lo + DSIZE;
+	PUT(HDRP(bp), PACK(msize, MAPPED | 1));
+	return bp;
+}
+
+/*
+ * trim - Gives the memory of the free block bp back to the OS if it
+ *        is at least trimThreshold bytes.  bp is what the block freed
+ *        of fsize bytes became after coalescing.  The last block in the
+ *        heap is cut down to CHUNKSIZE bytes so the next request doesn't
+ *        grow the heap right away.  Any other block keeps its size but
+ *        the whole pages between its header and footer are released.
+ *        A neighbor that was already trimThreshold bytes had its pages
+ *        released when it was freed, so only the pages of freed and the
+ *        ones it shares with its neighbors are released again.
+ */
+static void trim(void *bp, void *freed, size_t fsize)
+{
+	size_t size = GET_SIZE(HDRP(bp));
+	size_t page;
+	char *lo = bp;
+	char *hi = FTRP(bp);
+
+	if (trimThreshold <= 0 || size < (size_t)trimThreshold)
+		return;
+
+	if (GET_SIZE(HDRP(NEXT_BLKP(bp))) != 0)
+	{
+		page = mem_pagesize();
+		// a big neighbor's pages stop short of its footer
+		// and start at its payload
+		if ((size_t)((char *)freed - (char *)bp) >= (size_t)trimThreshold)
+			lo = MAX(lo, (char *)(((unsigned long)freed - DSIZE) & ~(page - 1)));
+		if ((size_t)(NEXT_BLKP(bp) - ((char *)freed + fsize)) >=
+		    (size_t)trimThreshold)
+			hi = MIN(hi, (char *)(((unsigned long)freed + fsize +
+			                       page - 1) & ~(page - 1)));
+		if (lo < hi)
+			mem_release(lo, hi - lo);
+		return;
+	}
+	if (size <= CHUNKSIZE || mem_sbrk(-(int)(size - CHUNKSIZE)) == (void *)-1)
+		return;
+
+	PUT(HDRP(bp), PACK(CHUNKSIZE, GET_PREV_ALLOC(HDRP(bp))));
+	PUT(FTRP(bp), PACK(CHUNKSIZE, 0));
+	PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+	markFree(bp, CHUNKSIZE);
+
+	// next fit can't start past the new epilogue
+	if (current > NEXT_BLKP(bp))
+		current = NEXT_BLKP(bp);
+}
+
+/*
+ * consolidate - Frees every block in the fast bins for real, so they
+ *               coalesce with their neighbors.  Blocks next to a block
+ *               that is still in a fast bin look allocated, but they
+ *               are joined when that block is freed later in the pass.
+ *               Like mm_free, it gives back the memory of the blocks
+ *               that coalescing makes big enough.
+ */
+static void consolidate(void)
+{
+	char *bp;
+	int i;
+
+	for (i = 0; i < NUMFAST; i++)
+	{
+		while ((bp = fastBin[i]) != NULL)
+		{
+			size_t size = GET_SIZE(HDRP(bp));
+
+			fastBin[i] = FAST_NEXT(bp);
+			// coalescing can make a block big enough to give back
+			trim(freeBlock(bp), bp, size);
+		}
+	}
+	fastCount = 0;
+}
+
+/*
+ * mm_realloc - Resize the block pointed to by ptr to size bytes.
+ *              The block is shrunk or grown in place when possible.
+ *              A block with a mapping of its own is resized with
+ *              mremap.
+ *              Otherwise allocate a new block of size bytes and copy
+ *              the contents of the block pointed to by ptr into it.
  *              Returns a pointer to the payload of the new block.
  */
 void *mm_realloc(void *ptr, size_t size)
@@ -222,9 +557,18 @@ void *mm_realloc(void *ptr, size_t size)
 		mm_free(ptr);
 		return NULL;
 	}
-	// See if block is already big enough
-	// need room for payload of size bytes, header, and footer
-	if (GET_SIZE(HDRP(ptr)) >= (size + WSIZE + WSIZE))
+	// a mapped block that is still big enough for a mapping of its
+	// own is resized by the kernel without copying
+	if (GET_MAPPED(HDRP(ptr)) && mmapThreshold > 0 &&
+	    adjustSize(size) >= (size_t)mmapThreshold)
+	{
+		void *newptr = remapBlock(ptr, adjustSize(size));
+		if (newptr != NULL)
+			return newptr;
+	}
+	// Shrink the block, or grow it into the free block after it or
+	// into new heap space if it is the last block in the heap
+	if (!GET_MAPPED(HDRP(ptr)) && resizeInPlace(ptr, adjustSize(size)))
 	{
 		return ptr;
 	}
@@ -236,7 +580,10 @@ void *mm_realloc(void *ptr, size_t size)
 	if (newptr == NULL)
 		return NULL;
 
-	size_t copySize = GET_SIZE(HDRP(oldptr));
+	// the payload is everything after the header, which is DSIZE
+	// bytes into a mapping
+	size_t copySize = GET_SIZE(HDRP(oldptr)) -
+	                  (GET_MAPPED(HDRP(oldptr)) ? DSIZE : WSIZE);
 
 	// if the original block is bigger then
 	// only copy what will fit into the new block
@@ -246,12 +593,80 @@ void *mm_realloc(void *ptr, size_t size)
 	// Copy the contents of the old block into
 	// the new block
 	memcpy(newptr, oldptr, copySize);
+	reallocCopied += copySize;
 	// Free the old block
 	mm_free(oldptr);
 
 	return newptr;
 }
 
+/*
+ * adjustSize - Returns the size of the block needed for a payload of
+ *              size bytes.  Adds room for the header and footer and
+ *              rounds up to a multiple of DSIZE.
+ */
+static size_t adjustSize(size_t size)
+{
+	// minimum block size is 2*DSIZE, which leaves room for the
+	// footer once the block is freed
+	if (size <= DSIZE + WSIZE)
+		return 2 * DSIZE;
+
+	// size must be a multiple of DSIZE
+	return DSIZE * ((size + (WSIZE) + (DSIZE - 1)) / DSIZE);
+}
+
+/*
+ * resizeInPlace - Tries to make the allocated block bp asize bytes
+ *                 without moving it.
+ *                 A smaller block gives its tail back as a free block.
+ *                 A bigger block takes what it needs from the free
+ *                 block after it.  If bp is the last block in the heap
+ *                 (possibly followed by one free block) the heap is
+ *                 extended by the missing bytes.
+ *                 Returns 1 if bp now has room for asize bytes and 0
+ *                 if the block has to be moved.
+ */
+static int resizeInPlace(void *bp, size_t asize)
+{
+	size_t csize = GET_SIZE(HDRP(bp));
+	char *next = NEXT_BLKP(bp);
+	size_t avail = csize;
+
+	if (!GET_ALLOC(HDRP(next)))
+	{
+		avail += GET_SIZE(HDRP(next));
+		next = NEXT_BLKP(next);
+	}
+
+	// grow the heap if nothing but the epilogue follows
+	if (avail < asize && GET_SIZE(HDRP(next)) == 0)
+	{
+		if (extend_heap((asize - avail) / WSIZE) == NULL)
+			return 0;
+		avail = asize;
+	}
+	if (avail < asize)
+		return 0;
+
+	// bp and the free block after it become one allocated block
+	// and place splits off whatever isn't needed
+	if (!GET_ALLOC(HDRP(NEXT_BLKP(bp))))
+		markFree(NEXT_BLKP(bp), 0);
+	PUT(HDRP(bp), PACK(avail, GET_PREV_ALLOC(HDRP(bp)) | 1));
+	place(bp, asize);
+
+	// next fit can't start inside bp or inside the free block place
+	// split off after it
+	if ((char *)bp < current && current < NEXT_BLKP(NEXT_BLKP(bp)))
+		current = NEXT_BLKP(bp);
+
+	// the bytes bp gave up are freed like any other block
+	if (csize > asize && GET_SIZE(HDRP(bp)) == asize)
+		trim(NEXT_BLKP(bp), NEXT_BLKP(bp), csize - asize);
+	return 1;
+}
+
 /*
  * extend_heap - extends the size of the heap by words * WSIZE bytes
  *
@@ -265,14 +680,48 @@ static void *extend_heap(size_t words)
 	if (((long)(bp = mem_sbrk(size)) == -1))
 		return NULL;
 
-	PUT(HDRP(bp), PACK(size, 0));
+	// the old epilogue header becomes the new block's header and
+	// knows whether the block before it is allocated
+	PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
 	PUT(FTRP(bp), PACK(size, 0));
 	// add an epilogue at the end
 	PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
 
+	if (useFitTree)
+		treeGrow();
 	return coalesce(bp);
 }
 
+/*
+ * growHeap - Returns a free block of at least asize bytes at the end of
+ *            the heap, extending the heap if it has to.
+ *            If the last block is free it is only grown by the bytes
+ *            it is missing.  Otherwise a new chunk is added.
+ */
+static void *growHeap(size_t asize)
+{
+	char *epilogue = (char *)mem_heap_hi() + 1;
+	size_t heapsize = mem_heapsize();
+	size_t tail = 0, chunk = CHUNKSIZE;
+
+	// the epilogue knows whether the last block is free, and then
+	// the footer of that block is right before the epilogue header
+	if (!GET_PREV_ALLOC(HDRP(epilogue)))
+		tail = GET_SIZE(HDRP(epilogue) - WSIZE);
+	if (tail >= asize)
+		return PREV_BLKP(epilogue);
+	if (tail > 0)
+		return extend_heap((asize - tail) / WSIZE);
+
+	if (growthPercent > 0)
+	{
+		chunk = MAX(CHUNKSIZE, MIN(heapsize / 100 * growthPercent, CHUNKMAX));
+		// don't ask for more than is left
+		chunk = MIN(chunk, mem_max_heapsize() - heapsize) & ~(DSIZE - 1);
+	}
+	return extend_heap(MAX(asize, chunk) / WSIZE);
+}
+
 /*
  * coalesce - coalesces two or more blocks.
  *            bp points to the payload of the free block.
@@ -282,20 +731,27 @@ static void *extend_heap(size_t words)
  */
 static void *coalesce(void *bp)
 {
-	size_t prev_alloc = GET_ALLOC(FTRP(PREV_BLKP(bp)));
+	size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
 	size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
 	size_t size = GET_SIZE(HDRP(bp));
 
+	// the blocks joined to the one before them stop being free blocks
+	// of their own
+	if (!next_alloc)
+		markFree(NEXT_BLKP(bp), 0);
+	if (!prev_alloc)
+		markFree(bp, 0);
+
 	// case 1
 	if (prev_alloc && next_alloc)
 	{
-		return bp;
+		// nothing to join
 	}
 	// previous block is allocated and the next is free : case 2
 	else if (prev_alloc && !next_alloc)
 	{
 		size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
-		PUT(HDRP(bp), PACK(size, 0));
+		PUT(HDRP(bp), PACK(size, PREV_ALLOC));
 		PUT(FTRP(bp), PACK(size, 0));
 	}
 	// previous block is free and the next is allocated : case 3
@@ -303,14 +759,14 @@ static void *coalesce(void *bp)
 	{
 		size += GET_SIZE(HDRP(PREV_BLKP(bp)));
 		PUT(FTRP(bp), PACK(size, 0));
-		PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
+		PUT(HDRP(PREV_BLKP(bp)), PACK(size, PREV_ALLOC));
 		bp = PREV_BLKP(bp);
 	}
 	// previous block is free and the next is free : case 4
 	else if (!prev_alloc && !next_alloc)
 	{
 		size += GET_SIZE(HDRP(PREV_BLKP(bp))) + GET_SIZE(FTRP(NEXT_BLKP(bp)));
-		PUT(HDRP(PREV_BLKP(bp)), PACK(size, 0));
+		PUT(HDRP(PREV_BLKP(bp)), PACK(size, PREV_ALLOC));
 		PUT(FTRP(NEXT_BLKP(bp)), PACK(size, 0));
 		bp = PREV_BLKP(bp);
 	}
@@ -334,9 +790,34 @@ static void *coalesce(void *bp)
         current = bp;
     }
 
+	if (size > maxFree)
+		maxFree = size;
+	markFree(bp, size);
 	return bp;
 }
 
+/*
+ * find_fit - Searches for a free block of asize bytes with the
+ *            placement policy indicated by whichfit.
+ *            Returns a pointer to the found block or NULL if no
+ *            block fits.
+ */
+static void *find_fit(size_t asize)
+{
+	// don't search if no free block is big enough
+	if (asize > maxFree)
+		return NULL;
+
+	if (whichfit == BESTFIT)
+		return best_fit(asize);
+	else if (whichfit == GOODFIT)
+		return good_fit(asize);
+	else if (whichfit == NEXTFIT)
+		return next_fit(asize);
+	else
+		return first_fit(asize); // default
+}
+
 /*
  * first_fit - Starts at the beginning of the list and returns the
  *             first free block with a size that is greater than or
@@ -347,17 +828,27 @@ static void *coalesce(void *bp)
 static void *first_fit(size_t asize)
 {
 	void *bp;
+	size_t largest = 0;
+
+	if (useFitTree)
+		return treeFit(asize);
+
 	// start at the beginning of heap
 	// use size in the header to calculate the address of the next block
 	// when size is 0 then the epilogue block has been reached
-	for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	for (bp = FREE_FROM(heap_listp); GET_SIZE(HDRP(bp)) > 0;
+		 bp = FREE_FROM(NEXT_BLKP(bp)))
 	{
-		if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp))))
+		if (!GET_ALLOC(HDRP(bp)))
 		{
-			return bp;
+			if (asize <= GET_SIZE(HDRP(bp)))
+				return bp;
+			largest = MAX(largest, GET_SIZE(HDRP(bp)));
 		}
 	}
 
+	// every free block was looked at, so now maxFree is exact
+	maxFree = largest;
 	return NULL;
 }
 
@@ -377,11 +868,15 @@ static void *next_fit(size_t asize)
     //  One with proper size is found, and address is returned
     //  We reach end of heap
 	char* bp;
-    for (bp = current; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	size_t largest = 0;
+    for (bp = FREE_FROM(current); GET_SIZE(HDRP(bp)) > 0;
+		 bp = FREE_FROM(NEXT_BLKP(bp)))
 	{
-		if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp))))
+		if (!GET_ALLOC(HDRP(bp)))
 		{
-			return bp;
+			if (asize <= GET_SIZE(HDRP(bp)))
+				return bp;
+			largest = MAX(largest, GET_SIZE(HDRP(bp)));
 		}
 	}
     
@@ -389,16 +884,20 @@ static void *next_fit(size_t asize)
     // Set iterptr to the start of the heap, until...
     //  One with proper size is found, and address is returned
     //  We reach current
-	for (bp = heap_listp; bp < current; bp = NEXT_BLKP(bp))
+	for (bp = FREE_FROM(heap_listp); bp < current; bp = FREE_FROM(NEXT_BLKP(bp)))
 	{
-		if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp))))
+		if (!GET_ALLOC(HDRP(bp)))
 		{
-			return bp;
+			if (asize <= GET_SIZE(HDRP(bp)))
+				return bp;
+			largest = MAX(largest, GET_SIZE(HDRP(bp)));
 		}
 	}
     
     // If both of the above loops failed, return NULL.
     // There isn't enough adjacent free space in the heap to contain asize.
+    // Every free block was looked at, so now maxFree is exact.
+    maxFree = largest;
     return NULL;
 }
 
@@ -417,7 +916,9 @@ static void *best_fit(size_t asize)
     
     char* bp;
     char* smallest = NULL;
-    for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+    size_t largest = 0;
+    for (bp = FREE_FROM(heap_listp); GET_SIZE(HDRP(bp)) > 0;
+		 bp = FREE_FROM(NEXT_BLKP(bp)))
 	{
 		if (!GET_ALLOC(HDRP(bp)) && (asize <= GET_SIZE(HDRP(bp))))
 		{
@@ -428,41 +929,380 @@ static void *best_fit(size_t asize)
                 smallest = bp;
             }
 		}
+		if (!GET_ALLOC(HDRP(bp)))
+			largest = MAX(largest, GET_SIZE(HDRP(bp)));
 	}
     
+    // every free block was looked at, so now maxFree is exact
+    maxFree = largest;
     return smallest;
 }
 
 /*
- * place - Adds a header and footer to allocated block. If the block
+ * good_fit - Looks for a block of size asize bytes like best fit, but
+ *            looks at no more than goodProbes free blocks and returns
+ *            the smallest of them that fits, so it doesn't walk the
+ *            whole heap.  A block that is at most goodSlack percent
+ *            bigger than asize is taken right away.  The search starts
+ *            at current like next fit, so it doesn't look at the same
+ *            blocks every time.
+ *            Every free block counts against goodProbes, whether it fits
+ *            or not, like the explicit good fit, so a search never looks
+ *            at more than goodProbes blocks.
+ *            Returns NULL if none of the blocks it looked at fit, and
+ *            the heap is extended.
+ */
+static void *good_fit(size_t asize)
+{
+	char *bp = FREE_FROM(current);
+	char *best = NULL;
+	size_t slack = asize * goodSlack / 100;
+	size_t largest = 0;
+	int probes = 0;
+	int wrapped = 0;
+
+	while (1)
+	{
+		// wrap around to the beginning of the heap once
+		if (GET_SIZE(HDRP(bp)) == 0)
+		{
+			if (wrapped)
+				break;
+			wrapped = 1;
+			bp = FREE_FROM(heap_listp);
+		}
+		if (wrapped && bp >= current)
+			break;
+
+		if (!GET_ALLOC(HDRP(bp)))
+		{
+			size_t size = GET_SIZE(HDRP(bp));
+			if (probes++ == goodProbes)
+				return best;
+			if (asize <= size && size - asize <= slack)
+				return bp;
+			if (asize <= size && (best == NULL || size < GET_SIZE(HDRP(best))))
+				best = bp;
+			largest = MAX(largest, size);
+		}
+		bp = FREE_FROM(NEXT_BLKP(bp));
+	}
+
+	// the whole heap was walked, so if nothing fit maxFree is exact
+	if (best == NULL)
+		maxFree = largest;
+	return best;
+}
+
+/*
+ * place - Adds a header to allocated block. If the block
  *         is larger than needed and the leftover portion is at
  *         least the minimum block size then mark the remaining portion
- *         as a free block.
+ *         as a free block.  Keeps the prev-alloc bit of the block after
+ *         bp up to date.
  */
 static void place(void *bp, size_t asize)
 {
 	// get the size of the free block
 	size_t csize = GET_SIZE(HDRP(bp));
+	size_t prev = GET_PREV_ALLOC(HDRP(bp));
+
+	markFree(bp, 0);
 
 	// if the unused portion is at least 2*DSIZE
 	// then split the block into two
 	if ((csize - asize) >= (2 * DSIZE))
 	{
-		// add the header and footer to the allocated block
-		PUT(HDRP(bp), PACK(asize, 1));
-		PUT(FTRP(bp), PACK(asize, 1));
+		// add the header to the allocated block
+		PUT(HDRP(bp), PACK(asize, prev | 1));
 		bp = NEXT_BLKP(bp);
 		// add the header and footer to the unallocated block
-		PUT(HDRP(bp), PACK(csize - asize, 0));
+		PUT(HDRP(bp), PACK(csize - asize, PREV_ALLOC));
 		PUT(FTRP(bp), PACK(csize - asize, 0));
+		CLEAR_PREV_ALLOC(NEXT_BLKP(bp));
+		// a block shrunk by realloc can leave a free block bigger
+		// than any other
+		if (csize - asize > maxFree)
+			maxFree = csize - asize;
+		markFree(bp, csize - asize);
 	}
 	else
 	{
 		// use the entire block
-		// add the header and footer
-		PUT(HDRP(bp), PACK(csize, 1));
-		PUT(FTRP(bp), PACK(csize, 1));
+		// add the header and tell the next block
+		PUT(HDRP(bp), PACK(csize, prev | 1));
+		SET_PREV_ALLOC(NEXT_BLKP(bp));
+	}
+}
+
+/*
+ * markFree - Tells the fit tree and the free map that block bp is now a
+ *            free block of size bytes, or isn't free if size is 0.
+ */
+static void markFree(void *bp, size_t size)
+{
+	size_t g, w;
+
+	if (useFitTree)
+		treeSet(bp, size);
+	if (!useBitmap)
+		return;
+
+	g = ((char *)bp - (char *)mem_heap_lo()) / DSIZE;
+	w = g / 64;
+	if (size)
+	{
+		freeMap[w] |= 1ULL << (g % 64);
+		freeSummary[w / 64] |= 1ULL << (w % 64);
+		if (w >= mapWords)
+			mapWords = w + 1;
+	}
+	else
+	{
+		freeMap[w] &= ~(1ULL << (g % 64));
+		if (freeMap[w] == 0)
+			freeSummary[w / 64] &= ~(1ULL << (w % 64));
+	}
+}
+
+/*
+ * nextFree - Returns the first free block whose payload is at or after
+ *            bp, or the epilogue if there is none.  Looks in the word of
+ *            the free map that bp is in, then uses the summary to find
+ *            the next word that isn't 0.
+ */
+static char *nextFree(void *bp)
+{
+	char *lo = mem_heap_lo();
+	size_t g = ((char *)bp - lo) / DSIZE;
+	size_t w = g / 64;
+	unsigned long long bits;
+
+	if (w < mapWords)
+	{
+		bits = freeMap[w] & (~0ULL << (g % 64));
+		if (bits != 0)
+			return lo + (w * 64 + __builtin_ctzll(bits)) * DSIZE;
+
+		// one summary word at a time, starting with the bit of word w+1
+		for (w++; w < mapWords; w = (w / 64 + 1) * 64)
+		{
+			bits = freeSummary[w / 64] & (~0ULL << (w % 64));
+			if (bits != 0)
+			{
+				w = (w / 64) * 64 + __builtin_ctzll(bits);
+				return lo + (w * 64 + __builtin_ctzll(freeMap[w])) * DSIZE;
+			}
+		}
+	}
+	return (char *)mem_heap_hi() + 1;
+}
+
+/*
+ * treeSet - Makes size the leaf of the fit tree for block bp (0 if bp
+ *           isn't free) and fixes the nodes above it.  Stops early once
+ *           a node doesn't change.
+ */
+static void treeSet(void *bp, size_t size)
+{
+	size_t off = (char *)bp - (char *)mem_heap_lo();
+	size_t i = treeLeaves + off / TREE_GRAIN;
+	unsigned int max;
+
+	fitTree[i] = size ? size | ((off / DSIZE) & 1) : 0;
+	for (i /= 2; i > 0; i /= 2)
+	{
+		max = MAX(fitTree[2 * i], fitTree[2 * i + 1]);
+		if (fitTree[i] == max)
+			break;
+		fitTree[i] = max;
+	}
+}
+
+/*
+ * treeGrow - Doubles the number of leaves of the fit tree until they
+ *            cover the whole heap.  The node indexes change, so the tree
+ *            is built again from the free blocks in the heap.
+ */
+static void treeGrow(void)
+{
+	size_t need = (mem_heapsize() + TREE_GRAIN - 1) / TREE_GRAIN;
+	size_t i;
+	char *bp;
+
+	if (need <= treeLeaves)
+		return;
+	if (treeLeaves == 0)
+		treeLeaves = 1;
+	while (treeLeaves < need)
+		treeLeaves *= 2;
+
+	memset(fitTree, 0, 2 * treeLeaves * sizeof(fitTree[0]));
+	for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	{
+		if (!GET_ALLOC(HDRP(bp)))
+		{
+			size_t off = bp - (char *)mem_heap_lo();
+			fitTree[treeLeaves + off / TREE_GRAIN] =
+				GET_SIZE(HDRP(bp)) | ((off / DSIZE) & 1);
+		}
+	}
+	for (i = treeLeaves - 1; i > 0; i--)
+		fitTree[i] = MAX(fitTree[2 * i], fitTree[2 * i + 1]);
+}
+
+/*
+ * treeFit - Returns the lowest free block of at least asize bytes, or
+ *           NULL if the largest free block is too small.  The size in a
+ *           node is a multiple of 8 plus bit 0, so comparing it with
+ *           asize compares the sizes.
+ */
+static void *treeFit(size_t asize)
+{
+	size_t i = 1;
+
+	if (treeLeaves == 0 || fitTree[1] < asize)
+		return NULL;
+	while (i < treeLeaves)
+		i = (fitTree[2 * i] >= asize) ? 2 * i : 2 * i + 1;
+
+	return (char *)mem_heap_lo() + (i - treeLeaves) * TREE_GRAIN +
+		   (fitTree[i] & 1) * DSIZE;
+}
+
+/*
+ * mm_check - Checks the heap for consistency.  Every block must be
+ *            aligned and end inside the heap, every free block must have
+ *            matching header and footer, every prev-alloc bit must match
+ *            the block before it, no two free blocks can be next to each
+ *            other and current must be the start of a block.  No free
+ *            block can be bigger than maxFree, and the fit tree and the
+ *            free map (when they are used) must match the free blocks.
+ *            Returns 1 if the heap is consistent and 0 otherwise.
+ */
+int mm_check()
+{
+	char *bp;
+	char *epilogue = (char *)mem_heap_hi() + 1;
+	int prevAlloc = 1;
+	int roverFound = 0;
+	size_t heapFree = 0, treeFree = 0, mapFree = 0;
+	size_t i, off;
+
+	if (GET_SIZE(HDRP(heap_listp)) != DSIZE || !GET_ALLOC(HDRP(heap_listp)))
+	{
+		printf("mm_check: the prologue is wrong\n");
+		return 0;
+	}
+	for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+	{
+		if ((size_t)bp % DSIZE != 0 || NEXT_BLKP(bp) > epilogue ||
+		    (bp != heap_listp && GET_SIZE(HDRP(bp)) < 2 * DSIZE))
+		{
+			printf("mm_check: block %p has a bad address or size\n", bp);
+			return 0;
+		}
+		if ((GET_PREV_ALLOC(HDRP(bp)) != 0) != prevAlloc)
+		{
+			printf("mm_check: prev-alloc bit of %p is wrong\n", bp);
+			return 0;
+		}
+		prevAlloc = GET_ALLOC(HDRP(bp));
+		if (bp == current)
+			roverFound = 1;
+		if (!GET_ALLOC(HDRP(bp)))
+		{
+			if (GET_SIZE(HDRP(bp)) != GET_SIZE(FTRP(bp)) || GET_ALLOC(FTRP(bp)))
+			{
+				printf("mm_check: header and footer of %p don't match\n", bp);
+				return 0;
+			}
+			if (!GET_ALLOC(HDRP(NEXT_BLKP(bp))))
+			{
+				printf("mm_check: free block %p was not coalesced\n", bp);
+				return 0;
+			}
+			if (GET_SIZE(HDRP(bp)) > maxFree)
+			{
+				printf("mm_check: free block %p is bigger than maxFree %zu\n",
+				       bp, maxFree);
+				return 0;
+			}
+			heapFree++;
+			off = bp - (char *)mem_heap_lo();
+			if (useFitTree && fitTree[treeLeaves + off / TREE_GRAIN] !=
+			    (GET_SIZE(HDRP(bp)) | ((off / DSIZE) & 1)))
+			{
+				printf("mm_check: fit tree leaf of %p is wrong\n", bp);
+				return 0;
+			}
+			if (useBitmap && !((freeMap[off / DSIZE / 64] >> (off / DSIZE % 64)) & 1))
+			{
+				printf("mm_check: free map bit of %p isn't set\n", bp);
+				return 0;
+			}
+		}
+	}
+	if (bp != epilogue)
+	{
+		printf("mm_check: the epilogue %p isn't at the end of the heap\n", bp);
+		return 0;
+	}
+	if ((GET_PREV_ALLOC(HDRP(bp)) != 0) != prevAlloc)
+	{
+		printf("mm_check: prev-alloc bit of the epilogue is wrong\n");
+		return 0;
+	}
+	// next fit may also start at the epilogue
+	if (!roverFound && current != bp)
+	{
+		printf("mm_check: current %p isn't the start of a block\n", current);
+		return 0;
+	}
+
+	// every leaf that isn't 0 is a free block seen above, and every
+	// other node is the larger of its children
+	if (useFitTree)
+	{
+		for (i = treeLeaves; i < 2 * treeLeaves; i++)
+			treeFree += (fitTree[i] != 0);
+		for (i = 1; i < treeLeaves; i++)
+		{
+			if (fitTree[i] != MAX(fitTree[2 * i], fitTree[2 * i + 1]))
+			{
+				printf("mm_check: fit tree node %zu is wrong\n", i);
+				return 0;
+			}
+		}
+		if (treeFree != heapFree)
+		{
+			printf("mm_check: %zu free blocks in the heap but %zu in the fit tree\n",
+			       heapFree, treeFree);
+			return 0;
+		}
+	}
+
+	// every bit of the free map is a free block seen above, and the
+	// summary has a bit for each word that isn't 0
+	if (useBitmap)
+	{
+		for (i = 0; i < mapWords; i++)
+		{
+			mapFree += __builtin_popcountll(freeMap[i]);
+			if (((freeSummary[i / 64] >> (i % 64)) & 1) != (freeMap[i] != 0))
+			{
+				printf("mm_check: summary bit of free map word %zu is wrong\n", i);
+				return 0;
+			}
+		}
+		if (mapFree != heapFree)
+		{
+			printf("mm_check: %zu free blocks in the heap but %zu in the free map\n",
+			       heapFree, mapFree);
+			return 0;
+		}
 	}
+	return 1;
 }
 
 /*
@@ -472,10 +1312,10 @@ static void place(void *bp, size_t asize)
 void printBlocks()
 {
 	char *bp;
-	printf("%10s %10s %1s\n", "Addr", "Size", "a");
+	printf("%14s %10s %1s\n", "Addr", "Size", "a");
 	for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
 	{
-		printf("%#10x %#10x %d\n", (unsigned int)bp, GET_SIZE(HDRP(bp)),
+		printf("%14p %#10x %d\n", bp, GET_SIZE(HDRP(bp)),
 			   GET_ALLOC(HDRP(bp)));
 	}
 }
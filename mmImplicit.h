@@ -2,6 +2,7 @@
 #define FIRSTFIT 1
 #define NEXTFIT 2
 #define BESTFIT 3
+#define GOODFIT 5
 
 extern int mm_init(void);
 extern void *mm_malloc(size_t size);
@@ -10,3 +11,12 @@ extern void *mm_realloc(void *ptr, size_t size);
 extern int mm_check();
 extern void printBlocks();
 extern int whichfit;
+extern int goodProbes;
+extern int goodSlack;
+extern int useFastBins;
+extern int useFitTree;
+extern int useBitmap;
+extern int growthPercent;
+extern int trimThreshold;
+extern int mmapThreshold;
+extern size_t reallocCopied;
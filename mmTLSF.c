@@ -0,0 +1,858 @@
+/*
+ * mmTLSF.c - The file contains the implementation of a memory manager
+ *            that uses two-level segregated fit (TLSF).  The free blocks
+ *            are kept in an array of explicit lists indexed by two
+ *            levels of size classes and two levels of bitmaps record
+ *            which of those lists have blocks in them.  Finding a free
+ *            block, freeing a block and coalescing take constant time,
+ *            so mm_malloc and mm_free have a worst case bound that does
+ *            not depend on the number of blocks in the heap (other than
+ *            the time spent in mem_sbrk).
+ *
+ *            The placement is a good fit: the request is rounded up to
+ *            the start of the next second level class so that any block
+ *            in the list that is found is big enough.  whichfit has no
+ *            effect on this allocator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "mmTLSF.h"
+#include "memlib.h"
+#include "config.h"
+/*
+ * The blocks have the same form as in mmExplicit.c.  Each block has a
+ * header holding the size, the allocation bit, the prev-alloc bit p and
+ * the mapped bit m, which is only set for an allocated block in a
+ * mapping of its own.  A free block also has a footer and pointers to
+ * the previous and next free blocks in its list right after the header.
+ *
+ *      31                     3  2  1  0
+ *      ------------------------------------
+ *     | s  s  s  s  ... s  s  s  0  p  0   |
+ *      ------------------------------------
+ *     |        predecessor free block      |
+ *      ------------------------------------
+ *     |        successor free block        |
+ *      ------------------------------------
+ *     |                                    |
+ *      ------------------------------------
+ *     | s  s  s  s  ... s  s  s  0  0  0   |
+ *      ------------------------------------
+ *
+ * The free lists are indexed by (fl, sl).  The first level fl is the
+ * position of the most significant bit of the size and the second
+ * level sl splits each power of two range into SL_COUNT lists of
+ * equal width.  All sizes below SMALL_BLOCK are in first level 0,
+ * which is split into lists that are DSIZE bytes apart.
+ *
+ *    fl_bitmap:  bit fl is set if any list of first level fl has blocks
+ *    sl_bitmap[fl]:  bit sl is set if list (fl, sl) has blocks
+ *
+ * The heap has the same prologue and epilogue blocks as the other
+ * allocators, and grows the same way: by what a free block at its end
+ * is missing, or by CHUNKSIZE (growthPercent of the heap size if set).
+ * It also shrinks the same way when trimThreshold is set.
+ */
+
+// MACROS
+#define WSIZE 4
+#define DSIZE 8
+#define CHUNKSIZE (1 << 12)
+#define CHUNKMAX (1 << 18) // largest chunk growthPercent asks for
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+// create a header or footer by ORing the size and allocation bits
+#define PACK(size, alloc) ((size) | (alloc))
+
+// get the word stored in address p
+#define GET(p) (*(unsigned int *)(p))
+// store a word in memory at address p
+#define PUT(p, val) (*(unsigned int *)(p) = (val))
+
+// The free list links are stored as 4 byte offsets from the start of the
+// heap instead of as pointers, so a free block needs the same room on a
+// 64-bit machine as on a 32-bit one.  Offset 0 is the padding word at the
+// start of the heap, which is never a block, so it stands for NULL.
+#define GET_PTR(p) (GET(p) ? heap_base + GET(p) : NULL)
+#define PUT_PTR(p, ptr) PUT(p, (ptr) ? (unsigned int)((char *)(ptr)-heap_base) : 0)
+
+// size is going to be a multiple of 8 so ignore the lower
+// three bits when getting the size out of the header or footer
+#define GET_SIZE(p) (GET(p) & ~0x7)
+
+// get the allocation bit out of the header or footer
+#define GET_ALLOC(p) (GET(p) & 0x1)
+
+// bit 1 of a header is set if the previous block in memory is allocated.
+// Allocated blocks don't have a footer, so this bit is the only way to
+// tell whether the previous block is free without following PREV_BLKP.
+#define PREV_ALLOC 0x2
+#define GET_PREV_ALLOC(p) (GET(p) & PREV_ALLOC)
+// set or clear the prev-alloc bit in the header of block bp
+#define SET_PREV_ALLOC(bp) PUT(HDRP(bp), GET(HDRP(bp)) | PREV_ALLOC)
+#define CLEAR_PREV_ALLOC(bp) PUT(HDRP(bp), GET(HDRP(bp)) & ~PREV_ALLOC)
+
+// bit 2 of a header is set if the block is in a mapping of its own
+// (see mapBlock); its size is then the size of the mapping
+#define MAPPED 0x4
+#define GET_MAPPED(p) (GET(p) & MAPPED)
+// bytes of mapping a block of asize bytes needs
+#define MAP_SIZE(asize) (((asize) + WSIZE + mem_pagesize() - 1) & ~(mem_pagesize() - 1))
+
+// bp is the address of the payload
+// HDRP returns the address of the header
+#define HDRP(bp) ((char *)(bp)-WSIZE)
+// FTRP returns the address of the footer; only free blocks have one
+#define FTRP(bp) ((char *)(bp) + GET_SIZE(HDRP(bp)) - DSIZE)
+// PRED returns the address of the pred field
+#define PRED(bp) ((char *)(bp))
+// SUCC returns the address of the succ field
+#define SUCC(bp) ((char *)(bp) + WSIZE)
+
+// NEXT_BLKP returns a pointer to the payload of the next block
+#define NEXT_BLKP(bp) ((char *)(bp) + GET_SIZE(((char *)(bp)-WSIZE)))
+// PREV_BLKP returns a pointer to the payload of the previous block
+// only valid if the previous block is free since it reads its footer
+#define PREV_BLKP(bp) ((char *)(bp)-GET_SIZE(((char *)(bp)-DSIZE)))
+
+// Index parameters
+// log2 of the number of second level lists per first level
+#define SL_LOG2 4
+#define SL_COUNT (1 << SL_LOG2)
+// log2 of DSIZE; the sizes are always multiples of DSIZE
+#define ALIGN_LOG2 3
+// sizes below SMALL_BLOCK all belong to first level 0
+#define FL_SHIFT (SL_LOG2 + ALIGN_LOG2)
+#define SMALL_BLOCK (1 << FL_SHIFT)
+// enough first levels for any size that fits in a header
+#define FL_COUNT (32 - FL_SHIFT + 1)
+
+#define MINBLOCK (2 * DSIZE)
+
+// position of the least and most significant set bit of a nonzero word
+#define FFS(x) (__builtin_ctz(x))
+#define FLS(x) (31 - __builtin_clz(x))
+
+// Memory Pointers
+// points to payload (footer) of first block in heap, which is prologue block
+static char *heap_listp;
+// first byte of the heap; the free list links are offsets from here
+static char *heap_base;
+// first level bitmap
+static unsigned int fl_bitmap;
+// second level bitmaps, one per first level
+static unsigned int sl_bitmap[FL_COUNT];
+// heads of the free lists
+static char *blocks[FL_COUNT][SL_COUNT];
+
+// Helper Functions
+static void *extend_heap(size_t words);
+static void *growHeap(size_t asize);
+static void trim(void *bp, void *freed, size_t fsize);
+static void *mapBlock(size_t asize);
+static void unmapBlock(void *bp);
+static void *remapBlock(void *bp, size_t asize);
+static void *coalesce(void *bp);
+static void *find_fit(size_t asize);
+static void place(void *bp, size_t asize);
+static size_t adjustSize(size_t size);
+static int resizeInPlace(void *bp, size_t asize);
+static void mapping(size_t size, int *fl, int *sl);
+static void removeBlock(void *bp);
+static void insertBlock(void *bp);
+
+/* not used by TLSF; here so the driver can be shared */
+int whichfit = FIRSTFIT;
+
+/* if not 0, the heap grows by this percent of its size when nothing */
+/* fits instead of by CHUNKSIZE */
+int growthPercent = 0;
+
+/* if not 0, free blocks of at least this many bytes are given back */
+/* to the OS */
+int trimThreshold = 0;
+
+/* if not 0, requests of at least this many bytes get a mapping of */
+/* their own instead of a block in the heap */
+int mmapThreshold = 0;
+
+/* bytes mm_realloc has copied from one block to another */
+size_t reallocCopied = 0;
+
+/*
+ * mm_init - initialize the malloc package.  Creates the prologue
+ *           and epilogue blocks, clears the bitmaps and adds a big
+ *           free block.
+ */
+int mm_init(void)
+{
+   int fl, sl;
+
+   if ((heap_listp = mem_sbrk(4 * WSIZE)) == (void *)-1)
+      return -1;
+   heap_base = heap_listp;
+
+   PUT(heap_listp, 0);                                         // Padding
+   PUT(heap_listp + (1 * WSIZE), PACK(DSIZE, PREV_ALLOC | 1)); // Prologue header
+   PUT(heap_listp + (2 * WSIZE), PACK(DSIZE, 1));              // Prologue footer
+   PUT(heap_listp + (3 * WSIZE), PACK(0, PREV_ALLOC | 1));     // Epilogue header
+   heap_listp += (2 * WSIZE);
+
+   fl_bitmap = 0;
+   for (fl = 0; fl < FL_COUNT; fl++)
+   {
+      sl_bitmap[fl] = 0;
+      for (sl = 0; sl < SL_COUNT; sl++)
+         blocks[fl][sl] = 0;
+   }
+
+   if (extend_heap(CHUNKSIZE / WSIZE) == NULL)
+      return -1;
+   return 0;
+}
+
+/*
+ * mm_malloc - Finds a free block in the first nonempty list whose
+ *     blocks are all at least size bytes.  If no block can be
+ *     found, extend the heap.
+ */
+void *mm_malloc(size_t size)
+{
+   size_t asize;
+   char *bp;
+
+   if (size == 0)
+      return NULL;
+
+   asize = adjustSize(size);
+
+   // big requests get a mapping of their own if there is one to be had
+   if (mmapThreshold > 0 && asize >= (size_t)mmapThreshold &&
+       (bp = mapBlock(asize)) != NULL)
+      return bp;
+
+   if ((bp = find_fit(asize)) != NULL)
+   {
+      removeBlock(bp);
+      place(bp, asize);
+      return bp;
+   }
+
+   // No free block found, extend the heap.  The new block may have
+   // been coalesced with a free block at the end of the heap and is
+   // big enough even if it isn't in a list that find_fit would pick.
+   if ((bp = growHeap(asize)) == NULL)
+      return NULL;
+
+   removeBlock(bp);
+   place(bp, asize);
+   return bp;
+}
+
+/*
+ * mm_free - Free the block and coalesce it with adjacent free blocks.
+ *           ptr points to the payload of the block to be free.
+ */
+void mm_free(void *ptr)
+{
+   size_t size = GET_SIZE(HDRP(ptr));
+
+   if (GET_MAPPED(HDRP(ptr)))
+   {
+      unmapBlock(ptr);
+      return;
+   }
+   if (GET_ALLOC(HDRP(ptr)) == 0)
+      return;
+
+   PUT(HDRP(ptr), PACK(size, GET_PREV_ALLOC(HDRP(ptr))));
+   PUT(FTRP(ptr), PACK(size, 0));
+   CLEAR_PREV_ALLOC(NEXT_BLKP(ptr));
+   trim(coalesce(ptr), ptr, size);
+}
+
+/*
+ * mm_realloc - Resize the block pointed to by ptr to size bytes.
+ *              The block is shrunk or grown in place when possible.
+ *              A block with a mapping of its own is resized with
+ *              mremap.
+ *              Otherwise allocate a new block of size bytes and copy
+ *              the contents of the block pointed to by ptr into it.
+ *              Returns a pointer to the payload of the new block.
+ */
+void *mm_realloc(void *ptr, size_t size)
+{
+   if (ptr == NULL)
+   {
+      return mm_malloc(size);
+   }
+   if (size == 0)
+   {
+      mm_free(ptr);
+      return NULL;
+   }
+   // a mapped block that is still big enough for a mapping of its
+   // own is resized by the kernel without copying
+   if (GET_MAPPED(HDRP(ptr)) && mmapThreshold > 0 &&
+       adjustSize(size) >= (size_t)mmapThreshold)
+   {
+      void *newptr = remapBlock(ptr, adjustSize(size));
+      if (newptr != NULL)
+         return newptr;
+   }
+   // Shrink the block, or grow it into the free block after it or
+   // into new heap space if it is the last block in the heap
+   if (!GET_MAPPED(HDRP(ptr)) && resizeInPlace(ptr, adjustSize(size)))
+   {
+      return ptr;
+   }
+
+   void *oldptr = ptr;
+   void *newptr = mm_malloc(size);
+
+   // if malloc fails, give up
+   if (newptr == NULL)
+      return NULL;
+
+   // the payload is everything after the header, which is DSIZE
+   // bytes into a mapping
+   size_t copySize = GET_SIZE(HDRP(oldptr)) -
+                     (GET_MAPPED(HDRP(oldptr)) ? DSIZE : WSIZE);
+
+   // only copy what will fit into the new block
+   if (size < copySize)
+      copySize = size;
+
+   memcpy(newptr, oldptr, copySize);
+   reallocCopied += copySize;
+   mm_free(oldptr);
+
+   return newptr;
+}
+
+/*
+ * mapping - Computes the first and second level indexes of the list
+ *           that holds blocks of size bytes.
+ */
+static void mapping(size_t size, int *fl, int *sl)
+{
+   if (size < SMALL_BLOCK)
+   {
+      *fl = 0;
+      *sl = size / (SMALL_BLOCK / SL_COUNT);
+   }
+   else
+   {
+      int msb = FLS(size);
+      // the SL_LOG2 bits after the most significant bit pick the list
+      *sl = (size >> (msb - SL_LOG2)) ^ SL_COUNT;
+      *fl = msb - FL_SHIFT + 1;
+   }
+}
+
+/*
+ * find_fit - Returns a free block of at least asize bytes or NULL.
+ *            The size is rounded up to the next list boundary so that
+ *            every block in the list that is picked fits.  The bitmaps
+ *            give the first nonempty list at or above that one without
+ *            looking at any of the lists.
+ */
+static void *find_fit(size_t asize)
+{
+   int fl, sl;
+   unsigned int sl_map, fl_map;
+
+   if (asize >= SMALL_BLOCK)
+      asize += (1 << (FLS(asize) - SL_LOG2)) - 1;
+   mapping(asize, &fl, &sl);
+   if (fl >= FL_COUNT)
+      return NULL;
+
+   // lists in the same first level that are at least as big
+   sl_map = sl_bitmap[fl] & (~0U << sl);
+   if (sl_map == 0)
+   {
+      // otherwise the smallest nonempty list of a bigger first level
+      if (fl + 1 >= FL_COUNT)
+         return NULL;
+      fl_map = fl_bitmap & (~0U << (fl + 1));
+      if (fl_map == 0)
+         return NULL;
+      fl = FFS(fl_map);
+      sl_map = sl_bitmap[fl];
+   }
+   sl = FFS(sl_map);
+   return blocks[fl][sl];
+}
+
+/*
+ * insertBlock - Pushes the free block bp onto the front of the list for
+ *               its size and sets the bitmap bits for that list.
+ */
+static void insertBlock(void *bp)
+{
+   int fl, sl;
+   char *head;
+
+   mapping(GET_SIZE(HDRP(bp)), &fl, &sl);
+   head = blocks[fl][sl];
+
+   PUT_PTR(PRED(bp), 0);
+   PUT_PTR(SUCC(bp), head);
+   if (head != 0)
+      PUT_PTR(PRED(head), bp);
+   blocks[fl][sl] = bp;
+
+   fl_bitmap |= 1U << fl;
+   sl_bitmap[fl] |= 1U << sl;
+}
+
+/*
+ * removeBlock - Takes the free block bp out of the list for its size and
+ *               clears the bitmap bits if the list is now empty.
+ */
+static void removeBlock(void *bp)
+{
+   int fl, sl;
+   char *previousElement = GET_PTR(PRED(bp));
+   char *nextElement = GET_PTR(SUCC(bp));
+
+   mapping(GET_SIZE(HDRP(bp)), &fl, &sl);
+
+   if (nextElement)
+      PUT_PTR(PRED(nextElement), previousElement);
+   if (previousElement)
+   {
+      PUT_PTR(SUCC(previousElement), nextElement);
+   }
+   else
+   {
+      blocks[fl][sl] = nextElement;
+      if (nextElement == 0)
+      {
+         sl_bitmap[fl] &= ~(1U << sl);
+         if (sl_bitmap[fl] == 0)
+            fl_bitmap &= ~(1U << fl);
+      }
+   }
+}
+
+/*
+ * adjustSize - Returns the size of the block needed for a payload of
+ *              size bytes.  Adds room for the header and footer and
+ *              rounds up to a multiple of DSIZE.  The block must also
+ *              have room for the free list links once it is freed.
+ */
+static size_t adjustSize(size_t size)
+{
+   // minimum block size is 2*DSIZE, which leaves room for the
+   // footer and links once the block is freed
+   if (size <= DSIZE + WSIZE)
+      return 2 * DSIZE;
+
+   // size must be a multiple of DSIZE
+   return DSIZE * ((size + (WSIZE) + (DSIZE - 1)) / DSIZE);
+}
+
+/*
+ * resizeInPlace - Tries to make the allocated block bp asize bytes
+ *                 without moving it.
+ *                 A smaller block gives its tail back as a free block.
+ *                 A bigger block takes what it needs from the free
+ *                 block after it.  If bp is the last block in the heap
+ *                 (possibly followed by one free block) the heap is
+ *                 extended by the missing bytes.
+ *                 Returns 1 if bp now has room for asize bytes and 0
+ *                 if the block has to be moved.
+ */
+static int resizeInPlace(void *bp, size_t asize)
+{
+   size_t csize = GET_SIZE(HDRP(bp));
+   char *next = NEXT_BLKP(bp);
+   size_t avail = csize;
+
+   if (!GET_ALLOC(HDRP(next)))
+   {
+      avail += GET_SIZE(HDRP(next));
+      next = NEXT_BLKP(next);
+   }
+
+   // grow the heap if nothing but the epilogue follows; the new
+   // space is coalesced with the free block after bp, if any
+   if (avail < asize && GET_SIZE(HDRP(next)) == 0)
+   {
+      // the new space is a free block until it is merged, so it needs
+      // room for the links even if fewer bytes are missing
+      size_t grow = MAX(asize - avail, MINBLOCK);
+      if (extend_heap(grow / WSIZE) == NULL)
+         return 0;
+      avail += grow;
+   }
+   if (avail < asize)
+      return 0;
+
+   next = NEXT_BLKP(bp);
+   if (avail > csize)
+      removeBlock(next);
+
+   if ((avail - asize) >= MINBLOCK)
+   {
+      // split off the unused tail as a new free block
+      PUT(HDRP(bp), PACK(asize, GET_PREV_ALLOC(HDRP(bp)) | 1));
+      next = NEXT_BLKP(bp);
+      PUT(HDRP(next), PACK(avail - asize, PREV_ALLOC));
+      PUT(FTRP(next), PACK(avail - asize, 0));
+      CLEAR_PREV_ALLOC(NEXT_BLKP(next));
+      insertBlock(next);
+      // the bytes bp gave up are freed like any other block
+      if (csize > asize)
+         trim(next, next, csize - asize);
+   }
+   else
+   {
+      PUT(HDRP(bp), PACK(avail, GET_PREV_ALLOC(HDRP(bp)) | 1));
+      SET_PREV_ALLOC(NEXT_BLKP(bp));
+   }
+   return 1;
+}
+
+/*
+ * extend_heap - extends the size of the heap by words * WSIZE bytes
+ *               and returns the new free block after coalescing it
+ *               with the last block of the old heap.
+ */
+static void *extend_heap(size_t words)
+{
+   char *bp;
+   size_t size;
+
+   size = (words % 2) ? (words + 1) * WSIZE : words * WSIZE;
+
+   if (((long)(bp = mem_sbrk(size)) == -1))
+      return NULL;
+
+   // the old epilogue header becomes the new block's header and
+   // knows whether the block before it is allocated
+   PUT(HDRP(bp), PACK(size, GET_PREV_ALLOC(HDRP(bp))));
+   PUT(FTRP(bp), PACK(size, 0));
+   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+
+   return coalesce(bp);
+}
+
+/*
+ * growHeap - Returns a free block of at least asize bytes at the end of
+ *            the heap, extending the heap if it has to.
+ *            If the last block is free it is only grown by the bytes
+ *            it is missing.  Otherwise a new chunk is added.
+ */
+static void *growHeap(size_t asize)
+{
+   char *epilogue = (char *)mem_heap_hi() + 1;
+   size_t heapsize = mem_heapsize();
+   size_t tail = 0, chunk = CHUNKSIZE;
+
+   // the epilogue knows whether the last block is free, and then
+   // the footer of that block is right before the epilogue header
+   if (!GET_PREV_ALLOC(HDRP(epilogue)))
+      tail = GET_SIZE(HDRP(epilogue) - WSIZE);
+   if (tail >= asize)
+      return PREV_BLKP(epilogue);
+   if (tail > 0)
+      return extend_heap(MAX(asize - tail, MINBLOCK) / WSIZE);
+
+   if (growthPercent > 0)
+   {
+      chunk = MAX(CHUNKSIZE, MIN(heapsize / 100 * growthPercent, CHUNKMAX));
+      // don't ask for more than is left
+      chunk = MIN(chunk, mem_max_heapsize() - heapsize) & ~(DSIZE - 1);
+   }
+   return extend_heap(MAX(asize, chunk) / WSIZE);
+}
+
+/*
+ * mapBlock - Gives a block for asize bytes its own mapping outside the
+ *            heap.  The payload starts DSIZE bytes into the mapping so
+ *            it is aligned, and the header holds the mapping size.
+ *            Returns NULL if there is no mapping to be had.
+ */
+static void *mapBlock(size_t asize)
+{
+   size_t msize = MAP_SIZE(asize);
+   char *bp;
+
+   if ((bp = mem_map(msize)) == NULL)
+      return NULL;
+   bp += DSIZE;
+   PUT(HDRP(bp), PACK(msize, MAPPED | 1));
+   return bp;
+}
+
+/*
+ * unmapBlock - Gives the mapping of block bp back right away.
+ */
+static void unmapBlock(void *bp)
+{
+   mem_unmap((char *)bp - DSIZE, GET_SIZE(HDRP(bp)));
+}
+
+/*
+ * remapBlock - Resizes the mapping of block bp to hold asize bytes with
+ *              mremap, which moves page table entries instead of
+ *              copying the payload.  Returns the block's new address,
+ *              which may be different, or NULL if the mapping can't be
+ *              resized.
+ */
+static void *remapBlock(void *bp, size_t asize)
+{
+   size_t msize = MAP_SIZE(asize);
+   char *lo;
+
+   if (msize == GET_SIZE(HDRP(bp)))
+      return bp;
+   if ((lo = mem_remap((char *)bp - DSIZE, GET_SIZE(HDRP(bp)), msize)) == NULL)
+      return NULL;
+   bp = lo + DSIZE;
+   PUT(HDRP(bp), PACK(msize, MAPPED | 1));
+   return bp;
+}
+
+/*
+ * trim - Gives the memory of the free block bp back to the OS if it
+ *        is at least trimThreshold bytes.  bp is what the block freed
+ *        of fsize bytes became after coalescing.  The last block in
+ *        the heap is cut down to CHUNKSIZE bytes so the next request
+ *        doesn't grow the heap right away.  Any other block keeps its
+ *        size but the whole pages between its links and its footer are
+ *        released.  A neighbor that was already trimThreshold bytes had
+ *        its pages released when it was freed, so only the pages of
+ *        freed and the ones it shares with its neighbors are.
+ */
+static void trim(void *bp, void *freed, size_t fsize)
+{
+   size_t size = GET_SIZE(HDRP(bp));
+   size_t page;
+   char *lo = SUCC(bp) + WSIZE;
+   char *hi = FTRP(bp);
+
+   if (trimThreshold <= 0 || size < (size_t)trimThreshold)
+      return;
+
+   if (GET_SIZE(HDRP(NEXT_BLKP(bp))) != 0)
+   {
+      page = mem_pagesize();
+      // a big neighbor's pages stop short of its footer and its links
+      if ((size_t)((char *)freed - (char *)bp) >= (size_t)trimThreshold)
+         lo = MAX(lo, (char *)(((unsigned long)freed - DSIZE) & ~(page - 1)));
+      if ((size_t)(NEXT_BLKP(bp) - ((char *)freed + fsize)) >=
+          (size_t)trimThreshold)
+         hi = MIN(hi, (char *)(((unsigned long)freed + fsize + 2 * WSIZE +
+                                page - 1) & ~(page - 1)));
+      if (lo < hi)
+         mem_release(lo, hi - lo);
+      return;
+   }
+   if (size <= CHUNKSIZE || mem_sbrk(-(int)(size - CHUNKSIZE)) == (void *)-1)
+      return;
+
+   // the smaller block belongs in another list
+   removeBlock(bp);
+   PUT(HDRP(bp), PACK(CHUNKSIZE, GET_PREV_ALLOC(HDRP(bp))));
+   PUT(FTRP(bp), PACK(CHUNKSIZE, 0));
+   PUT(HDRP(NEXT_BLKP(bp)), PACK(0, 1));
+   insertBlock(bp);
+}
+
+/*
+ * coalesce - coalesces the free block bp with the blocks before and
+ *            after it if they are free and puts the result in the list
+ *            for its size.  bp must not be in a list yet.
+ *            Returns a pointer to the possibly bigger free block.
+ */
+static void *coalesce(void *bp)
+{
+   size_t prev_alloc = GET_PREV_ALLOC(HDRP(bp));
+   size_t next_alloc = GET_ALLOC(HDRP(NEXT_BLKP(bp)));
+   size_t size = GET_SIZE(HDRP(bp));
+
+   if (!next_alloc)
+   {
+      size += GET_SIZE(HDRP(NEXT_BLKP(bp)));
+      removeBlock(NEXT_BLKP(bp));
+   }
+   if (!prev_alloc)
+   {
+      size += GET_SIZE(HDRP(PREV_BLKP(bp)));
+      removeBlock(PREV_BLKP(bp));
+      bp = PREV_BLKP(bp);
+   }
+   // the block before a coalesced block is always allocated
+   PUT(HDRP(bp), PACK(size, PREV_ALLOC));
+   PUT(FTRP(bp), PACK(size, 0));
+   insertBlock(bp);
+   return bp;
+}
+
+/*
+ * place - Marks the free block bp allocated.  If the block is larger
+ *         than needed and the leftover portion is at least the minimum
+ *         block size then the leftover portion goes back in a list.
+ *         bp must already have been taken out of its list.
+ */
+static void place(void *bp, size_t asize)
+{
+   size_t csize = GET_SIZE(HDRP(bp));
+   size_t prev = GET_PREV_ALLOC(HDRP(bp));
+
+   if ((csize - asize) >= MINBLOCK)
+   {
+      PUT(HDRP(bp), PACK(asize, prev | 1));
+      void *nxtbp = NEXT_BLKP(bp);
+      PUT(HDRP(nxtbp), PACK(csize - asize, PREV_ALLOC));
+      PUT(FTRP(nxtbp), PACK(csize - asize, 0));
+      insertBlock(nxtbp);
+   }
+   else
+   {
+      PUT(HDRP(bp), PACK(csize, prev | 1));
+      SET_PREV_ALLOC(NEXT_BLKP(bp));
+   }
+}
+
+/*
+ * printBlocks - Prints the entire heap indicating which blocks are
+ *               allocated and which are free.
+ */
+void printBlocks()
+{
+   char *bp;
+   printf("Entire heap\n");
+   printf("%14s %10s %1s %10s %10s\n", "Addr", "Size", "a", "Pred", "Succ");
+   for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+   {
+      printf("%14p %#10x %d ", bp, GET_SIZE(HDRP(bp)),
+             GET_ALLOC(HDRP(bp)));
+      if (!GET_ALLOC(HDRP(bp)))
+         printf("%#10x %#10x", GET(PRED(bp)), GET(SUCC(bp)));
+      printf("\n");
+   }
+}
+
+/*
+ * printFreeList - Prints the bitmaps and the blocks in every nonempty
+ *                 free list.
+ */
+void printFreeList()
+{
+   char *bp;
+   int fl, sl;
+   printf("fl_bitmap: %#x\n", fl_bitmap);
+   for (fl = 0; fl < FL_COUNT; fl++)
+   {
+      for (sl = 0; sl < SL_COUNT; sl++)
+      {
+         if (blocks[fl][sl] == 0)
+            continue;
+         printf("Free list (%d, %d)  sl_bitmap: %#x\n", fl, sl, sl_bitmap[fl]);
+         printf("%14s %10s %1s %10s %10s\n", "Addr", "Size", "a", "Pred", "Succ");
+         for (bp = blocks[fl][sl]; bp != 0; bp = GET_PTR(SUCC(bp)))
+         {
+            printf("%14p %#10x %d %#10x %#10x\n", bp,
+                   GET_SIZE(HDRP(bp)), GET_ALLOC(HDRP(bp)),
+                   GET(PRED(bp)), GET(SUCC(bp)));
+         }
+      }
+   }
+}
+
+/*
+ * mm_check - Checks the heap for consistency.  Every free block must have
+ *            matching header and footer, every prev-alloc bit must match
+ *            the block before it, no two free blocks can be next
+ *            to each other, every free block must be in the list for
+ *            its size and the bitmaps must match the lists.
+ *            Returns 1 if the heap is consistent and 0 otherwise.
+ */
+int mm_check()
+{
+   char *bp;
+   int fl, sl, f, s;
+   int heapFree = 0;
+   int listFree = 0;
+
+   int prevAlloc = 1;
+
+   for (bp = heap_listp; GET_SIZE(HDRP(bp)) > 0; bp = NEXT_BLKP(bp))
+   {
+      if ((GET_PREV_ALLOC(HDRP(bp)) != 0) != prevAlloc)
+      {
+         printf("mm_check: prev-alloc bit of %p is wrong\n", bp);
+         return 0;
+      }
+      prevAlloc = GET_ALLOC(HDRP(bp));
+      if (!GET_ALLOC(HDRP(bp)))
+      {
+         if (GET_SIZE(HDRP(bp)) != GET_SIZE(FTRP(bp)) || GET_ALLOC(FTRP(bp)))
+         {
+            printf("mm_check: header and footer of %p don't match\n", bp);
+            return 0;
+         }
+         heapFree++;
+         if (!GET_ALLOC(HDRP(NEXT_BLKP(bp))))
+         {
+            printf("mm_check: free block %p was not coalesced\n", bp);
+            return 0;
+         }
+      }
+   }
+   if ((GET_PREV_ALLOC(HDRP(bp)) != 0) != prevAlloc)
+   {
+      printf("mm_check: prev-alloc bit of the epilogue is wrong\n");
+      return 0;
+   }
+
+   for (fl = 0; fl < FL_COUNT; fl++)
+   {
+      if (((fl_bitmap >> fl) & 1) != (sl_bitmap[fl] != 0))
+      {
+         printf("mm_check: fl_bitmap doesn't match level %d\n", fl);
+         return 0;
+      }
+      for (sl = 0; sl < SL_COUNT; sl++)
+      {
+         char *prev = 0;
+         if (((sl_bitmap[fl] >> sl) & 1) != (blocks[fl][sl] != 0))
+         {
+            printf("mm_check: sl_bitmap doesn't match list (%d, %d)\n", fl, sl);
+            return 0;
+         }
+         for (bp = blocks[fl][sl]; bp != 0; bp = GET_PTR(SUCC(bp)))
+         {
+            mapping(GET_SIZE(HDRP(bp)), &f, &s);
+            if (GET_ALLOC(HDRP(bp)) || f != fl || s != sl ||
+                GET_PTR(PRED(bp)) != prev)
+            {
+               printf("mm_check: block %p is in the wrong list\n", bp);
+               return 0;
+            }
+            prev = bp;
+            listFree++;
+         }
+      }
+   }
+
+   if (heapFree != listFree)
+   {
+      printf("mm_check: %d free blocks in the heap but %d in the lists\n",
+             heapFree, listFree);
+      return 0;
+   }
+   return 1;
+}
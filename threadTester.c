@@ -0,0 +1,207 @@
+/*
+ * This program is used to test the thread safe build of the explicit
+ * lists code.  Several threads allocate and free blocks at the same time.
+ * Every block is filled with a pattern that is checked before it is freed,
+ * so a block handed to two threads at once is caught.  The second test
+ * has producer threads whose blocks are all freed by consumer threads.
+ * The third runs the second again with slabs for the small requests.
+ * You can use it/modify it however you like.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "mmExplicit.h"
+#include "memlib.h"
+
+#define NUMTHREADS 8
+#define NUMOPS 100000
+#define NUMSLOTS 64
+#define NUMPAIRS 4
+
+//blocks handed from each producer to its consumer
+unsigned char *handoff[NUMPAIRS][NUMOPS];
+
+void *worker(void * arg);
+void *producer(void * arg);
+void *consumer(void * arg);
+int checkBlock(unsigned char * bp, size_t size, unsigned char pattern);
+
+int main(int argc, char * argv[])
+{
+   pthread_t threads[NUMTHREADS];
+   long i;
+   int failed = 0;
+   void *result;
+
+   printf("Thread Tester\n");
+   //You need these.  Don't delete these calls.
+   mem_init();
+   mm_init();
+
+   for (i = 0; i < NUMTHREADS; i++)
+      pthread_create(&threads[i], NULL, worker, (void *)i);
+   for (i = 0; i < NUMTHREADS; i++)
+   {
+      pthread_join(threads[i], &result);
+      if (result != NULL)
+         failed = 1;
+   }
+   if (failed)
+   {
+      printf("Thread Tester failed: a block was overwritten\n");
+      exit(0);
+   }
+
+   //the threads have exited, so their caches were given back to the heap
+   if (!mm_check()) exit(0);
+
+   for (i = 0; i < NUMPAIRS; i++)
+   {
+      pthread_create(&threads[2 * i], NULL, producer, (void *)i);
+      pthread_create(&threads[2 * i + 1], NULL, consumer, (void *)i);
+   }
+   for (i = 0; i < 2 * NUMPAIRS; i++)
+   {
+      pthread_join(threads[i], &result);
+      if (result != NULL)
+         failed = 1;
+   }
+   if (failed)
+   {
+      printf("Thread Tester failed: a block freed by another thread was overwritten\n");
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+
+   //slab objects freed by the consumers go on the producers' remote
+   //free stacks like any other block
+   useSlabs = 1;
+   mem_reset_brk();
+   mm_init();
+   memset(handoff, 0, sizeof(handoff));
+   for (i = 0; i < NUMPAIRS; i++)
+   {
+      pthread_create(&threads[2 * i], NULL, producer, (void *)i);
+      pthread_create(&threads[2 * i + 1], NULL, consumer, (void *)i);
+   }
+   for (i = 0; i < 2 * NUMPAIRS; i++)
+   {
+      pthread_join(threads[i], &result);
+      if (result != NULL)
+         failed = 1;
+   }
+   if (failed)
+   {
+      printf("Thread Tester failed: a slab object freed by another thread was overwritten\n");
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+   printf("Heap size after %d threads: %zu bytes\n", NUMTHREADS,
+          mem_heapsize());
+   printf("Thread Tester passed\n");
+   return 0;
+}
+
+/*
+ * worker - Randomly allocates and frees blocks held in NUMSLOTS slots.
+ *          Returns NULL if every block still held its pattern when it
+ *          was freed.
+ */
+void *worker(void * arg)
+{
+   unsigned char *slot[NUMSLOTS] = {0};
+   size_t slotSize[NUMSLOTS];
+   unsigned char pattern = (unsigned char)(long)arg + 1;
+   unsigned int seed = (unsigned int)(long)arg;
+   int i, s;
+   void *bad = NULL;
+
+   for (i = 0; i < NUMOPS && bad == NULL; i++)
+   {
+      s = rand_r(&seed) % NUMSLOTS;
+      if (slot[s] != NULL)
+      {
+         if (!checkBlock(slot[s], slotSize[s], pattern))
+            bad = slot[s];
+         mm_free(slot[s]);
+         slot[s] = NULL;
+      }
+      else
+      {
+         //mostly small blocks, some that skip the thread cache
+         slotSize[s] = (rand_r(&seed) % 8) ? rand_r(&seed) % 200 + 1
+                                           : rand_r(&seed) % 4000 + 1;
+         slot[s] = mm_malloc(slotSize[s]);
+         memset(slot[s], pattern, slotSize[s]);
+      }
+   }
+   for (s = 0; s < NUMSLOTS; s++)
+   {
+      if (slot[s] == NULL)
+         continue;
+      if (!checkBlock(slot[s], slotSize[s], pattern))
+         bad = slot[s];
+      mm_free(slot[s]);
+   }
+   return bad;
+}
+
+/*
+ * producer - Allocates NUMOPS blocks and hands each one to the consumer
+ *            of the same pair.  It never frees anything.
+ */
+void *producer(void * arg)
+{
+   long pair = (long)arg;
+   unsigned int seed = (unsigned int)pair;
+   unsigned char *bp;
+   size_t size;
+   int i;
+
+   for (i = 0; i < NUMOPS; i++)
+   {
+      size = rand_r(&seed) % 200 + 1;
+      bp = mm_malloc(size);
+      memset(bp, (unsigned char)size, size);
+      __atomic_store_n(&handoff[pair][i], bp, __ATOMIC_RELEASE);
+   }
+   return NULL;
+}
+
+/*
+ * consumer - Frees the blocks of its producer in the order they were
+ *            allocated.  The block size is also the fill pattern.
+ *            Returns NULL if every block still held its pattern.
+ */
+void *consumer(void * arg)
+{
+   long pair = (long)arg;
+   unsigned int seed = (unsigned int)pair;
+   unsigned char *bp;
+   size_t size;
+   int i;
+   void *bad = NULL;
+
+   for (i = 0; i < NUMOPS; i++)
+   {
+      size = rand_r(&seed) % 200 + 1;
+      while ((bp = __atomic_load_n(&handoff[pair][i], __ATOMIC_ACQUIRE)) == NULL)
+         ;
+      if (!checkBlock(bp, size, (unsigned char)size))
+         bad = bp;
+      mm_free(bp);
+   }
+   return bad;
+}
+
+/*
+ * checkBlock - Returns 1 if all size bytes of bp hold pattern.
+ */
+int checkBlock(unsigned char * bp, size_t size, unsigned char pattern)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      if (bp[i] != pattern)
+         return 0;
+   return 1;
+}
@@ -0,0 +1,274 @@
+/*
+ * This program is used to test the TLSF code.
+ * You can use it/modify it however you like.
+ */
+#include <string.h>
+#include <stdlib.h>
+#include "mmTLSF.h"
+#include "memlib.h"
+
+void addressCompare(void * correct, void * returned);
+void startOver();
+void runTest(void (*test)());
+void testTrim();
+void testMmap();
+void testGrowth();
+void testBigHeap();
+
+int main(int argc, char * argv[])
+{
+   void *bp1, *bp2, *bp3, *bp4;
+
+   printf("TLSF Tester\n");
+   //You need these.  Don't delete these calls.
+   mem_init();
+   mm_init();
+
+   printf("Blocks after mm_init:\n");
+   printBlocks();
+   printFreeList();
+   bp1 = mm_malloc(0x7f8);
+   bp2 = mm_malloc(0x3f8);
+   bp3 = mm_malloc(0x7f8);
+   printf("Blocks after mm_malloc(0x7f8), mm_malloc(0x3f8), mm_malloc(0x7f8):\n");
+   printBlocks();
+   printFreeList();
+   mm_free(bp2);
+   printf("Blocks after mm_free of the 0x400 block:\n");
+   printBlocks();
+   printFreeList();
+
+   //the 0x400 block is in list (4, 0), so a request that rounds up
+   //to that list gets it back
+   bp4 = mm_malloc(0x3f0);
+   addressCompare(bp2, bp4);
+
+   mm_free(bp1);
+   mm_free(bp4);
+   printBlocks();
+   printFreeList();   //bp1 and bp4 blocks should be coalesced
+   mm_free(bp3);
+   printBlocks();
+   printFreeList();   //everything is one free block again
+   if (!mm_check()) exit(0);
+
+   //each of these starts over on a new heap and runTest puts
+   //the old policies back when it is done
+   runTest(testTrim);
+   runTest(testMmap);
+   runTest(testGrowth);
+   runTest(testBigHeap);
+   printf("TLSF Tester passed\n");
+   return 0;
+}
+
+/*
+ * startOver - Throws the heap away and starts a new one with the
+ *             policies that are set now.
+ */
+void startOver()
+{
+   mem_reset_brk();
+   mm_init();
+}
+
+/*
+ * runTest - Calls test, which may change any of the policies, and
+ *           puts all of them back afterwards.
+ */
+void runTest(void (*test)())
+{
+   int growth = growthPercent;
+   int trim = trimThreshold, map = mmapThreshold;
+
+   test();
+   growthPercent = growth;
+   trimThreshold = trim;
+   mmapThreshold = map;
+}
+
+/*
+ * testTrim - With trimThreshold set, a big free block at the end of the
+ *            heap is cut off, and the pages inside a big free block
+ *            anywhere else are given back and read as zeros afterwards.
+ */
+void testTrim()
+{
+   char *bp1, *bp2;
+   size_t size;
+
+   trimThreshold = 0x2000;
+   startOver();
+   bp1 = mm_malloc(0x10000);
+   size = mem_heapsize();
+   mm_free(bp1);
+   if (mem_heapsize() >= size)
+   {
+      printf("Trim failed.\n");
+      printf("heap is still 0x%lx bytes\n", (unsigned long)mem_heapsize());
+      exit(0);
+   }
+
+   //the small block keeps this one from being the last block
+   bp1 = mm_malloc(0xfff8);
+   mm_malloc(0x18);
+   memset(bp1, 0xff, 0xfff8);
+   mm_free(bp1);
+   bp2 = mm_malloc(0xfff8);
+   addressCompare(bp1, bp2);
+   if (bp2[0x8000] != 0)
+   {
+      printf("Trim failed.\n");
+      printf("%p wasn't given back\n", bp2 + 0x8000);
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testMmap - With mmapThreshold set, a big request gets a mapping of
+ *            its own outside the heap.  It stays mapped when it grows
+ *            and the mapping goes away when it is freed.
+ */
+void testMmap()
+{
+   char *bp;
+   size_t size, copied;
+
+   mmapThreshold = 0x10000;
+   startOver();
+   size = mem_heapsize();
+   bp = mm_malloc(0x20000);
+   bp[0x1ffff] = 1;
+   if (!mem_is_mapped(bp, 0x20000) || mem_heapsize() != size)
+   {
+      printf("Mmap failed.\n");
+      printf("%p isn't in a mapping of its own\n", bp);
+      exit(0);
+   }
+   //small blocks still come from the heap
+   if (mem_is_mapped(mm_malloc(0x18), 0x18))
+   {
+      printf("Mmap failed.\n");
+      printf("a 0x18 byte request was mapped\n");
+      exit(0);
+   }
+
+   //the kernel moves the pages, so nothing is copied
+   copied = reallocCopied;
+   bp = mm_realloc(bp, 0x40000);
+   if (!mem_is_mapped(bp, 0x40000) || bp[0x1ffff] != 1 ||
+       reallocCopied != copied)
+   {
+      printf("Mmap failed.\n");
+      printf("%p wasn't remapped when it grew\n", bp);
+      exit(0);
+   }
+   mm_free(bp);
+   if (mem_mapsize() != 0)
+   {
+      printf("Mmap failed.\n");
+      printf("0x%lx bytes are still mapped\n", (unsigned long)mem_mapsize());
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testGrowth - A request that doesn't fit grows the heap only by what
+ *              the free block at its end is missing.  With growthPercent
+ *              set, a full heap grows by that percent of its size instead
+ *              of by one chunk.
+ */
+void testGrowth()
+{
+   char *bp1, *bp;
+   size_t size;
+
+   startOver();
+   //the 0x800 bytes after bp1 are the last block
+   bp1 = mm_malloc(0x7f8);
+   size = mem_heapsize();
+   bp = mm_malloc(0xbf8);
+   addressCompare(bp1 + 0x800, bp);
+   if (mem_heapsize() != size + 0x400)
+   {
+      printf("Growth failed.\n");
+      printf("the heap grew by 0x%lx bytes instead of 0x400\n",
+             (unsigned long)(mem_heapsize() - size));
+      exit(0);
+   }
+
+   //the heap is full now; without growthPercent it would grow by
+   //a 0x1000 byte chunk
+   growthPercent = 100;
+   size = mem_heapsize();
+   mm_malloc(0x18);
+   if (mem_heapsize() - size <= 0x1000)
+   {
+      printf("Growth failed.\n");
+      printf("a 0x%lx byte heap grew by only 0x%lx bytes\n",
+             (unsigned long)size, (unsigned long)(mem_heapsize() - size));
+      exit(0);
+   }
+   if (!mm_check()) exit(0);
+}
+
+/*
+ * testBigHeap - The heap can be set bigger than MAX_HEAP before mem_init.
+ *               Its pages are committed as the break moves past them, so
+ *               a block bigger than the old limit can be written up to
+ *               its last byte.  The new limit still holds.
+ */
+void testBigHeap()
+{
+   size_t limit = mem_max_heapsize();
+   char *bp;
+
+   mem_deinit();
+   mem_set_max_heap(2 * limit);
+   mem_init();
+   mm_init();
+   bp = mm_malloc(limit);
+   if (bp == NULL || mem_heapsize() <= limit)
+   {
+      printf("Big heap failed.\n");
+      printf("no 0x%lx byte block in a 0x%lx byte heap\n",
+             (unsigned long)limit, (unsigned long)(2 * limit));
+      exit(0);
+   }
+   bp[0] = 1;
+   bp[limit - 1] = 1;
+   //another block that big doesn't fit, and mem_sbrk prints an error
+   if (mm_malloc(limit) != NULL)
+   {
+      printf("Big heap failed.\n");
+      printf("the heap got bigger than 0x%lx bytes\n",
+             (unsigned long)(2 * limit));
+      exit(0);
+   }
+   mm_free(bp);
+   if (!mm_check()) exit(0);
+
+   //put the old limit back for the other tests
+   mem_deinit();
+   mem_set_max_heap(limit);
+   mem_init();
+   mm_init();
+}
+
+/*
+ * addressCompare - Takes two addresses as input and compares them.
+ *                  If the addresses don't match, an error message
+ *                  is printed and the program is exited.
+ */
+void addressCompare(void * correct, void * returned)
+{
+   if (correct != returned)
+   {
+      printf("TLSF placement failed.\n");
+      printf("Should have picked: %p \n", correct);
+      printf("Instead chose: %p\n", returned);
+      exit(0);
+   }
+}